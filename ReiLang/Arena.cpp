@@ -0,0 +1,58 @@
+#include "Arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+Arena::Arena(Arena&& other) noexcept:
+    blocks_(std::move(other.blocks_)),
+    finalizers_(std::move(other.finalizers_)),
+    cursor_(std::exchange(other.cursor_, nullptr)),
+    end_(std::exchange(other.end_, nullptr)),
+    bytes_(std::exchange(other.bytes_, 0))
+{
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+    if (this != &other) {
+        release_();
+        blocks_     = std::move(other.blocks_);
+        finalizers_ = std::move(other.finalizers_);
+        cursor_     = std::exchange(other.cursor_, nullptr);
+        end_        = std::exchange(other.end_, nullptr);
+        bytes_      = std::exchange(other.bytes_, 0);
+    }
+    return *this;
+}
+
+Arena::~Arena()
+{
+    release_();
+}
+
+void* Arena::allocate_(const std::size_t size, const std::size_t align)
+{
+    auto address = reinterpret_cast<std::uintptr_t>(cursor_);
+    auto aligned = (address + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1);
+    if (!cursor_ || aligned + size > reinterpret_cast<std::uintptr_t>(end_)) {
+        const std::size_t capacity = std::max(block_size_, size + align);
+        blocks_.push_back(std::make_unique<std::byte[]>(capacity));
+        cursor_ = blocks_.back().get();
+        end_ = cursor_ + capacity;
+        address = reinterpret_cast<std::uintptr_t>(cursor_);
+        aligned = (address + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1);
+    }
+    cursor_ = reinterpret_cast<std::byte*>(aligned + size);
+    bytes_ += size;
+    return reinterpret_cast<void*>(aligned);
+}
+
+void Arena::release_()
+{
+    for (auto f = finalizers_.rbegin(); f != finalizers_.rend(); ++f) {
+        f->destroy(f->object);
+    }
+    finalizers_.clear();
+    blocks_.clear();
+    cursor_ = end_ = nullptr;
+    bytes_ = 0;
+}
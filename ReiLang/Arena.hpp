@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+// Bump allocator: objects are placed one after another in large blocks
+// and are all destroyed, in reverse order, when the arena goes away.
+//
+class Arena
+{
+public:
+    Arena() = default;
+
+    Arena(const Arena&)              = delete;
+    Arena& operator = (const Arena&) = delete;
+    Arena(Arena&& other) noexcept;
+    Arena& operator = (Arena&& other) noexcept;
+    ~Arena();
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args);
+
+    [[nodiscard]] std::size_t bytes() const { return bytes_; }
+private:
+    static constexpr std::size_t block_size_ = 64 * 1024;
+
+    struct Finalizer
+    {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    void* allocate_(std::size_t size, std::size_t align);
+    void release_();
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    std::vector<Finalizer>                    finalizers_;
+    std::byte*                                cursor_ = nullptr;
+    std::byte*                                end_    = nullptr;
+    std::size_t                               bytes_  = 0;
+};
+
+template <typename T, typename ... Args>
+T* Arena::make(Args&&... args)
+{
+    T* object = new (allocate_(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+        finalizers_.push_back({ object, [](void* p) { static_cast<T*>(p)->~T(); } });
+    }
+    return object;
+}
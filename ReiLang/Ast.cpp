@@ -2,6 +2,7 @@
 #include <utility>
 
 Expr::Get::Get(Expr::Base::Ptr object, Token name):
+	Base(AstNodeType::Get),
 	object_(std::move(object)),
 	name_(std::move(name))
 {
@@ -13,6 +14,7 @@ Value Expr::Get::accept(Visitor& visitor)
 }
 
 Expr::Call::Call(Expr::Base::Ptr callee, Token paren, std::vector<Expr::Base::Ptr> arguments):
+    Base(AstNodeType::Call),
     callee_(std::move(callee)),
     paren_(std::move(paren)),
     arguments_(std::move(arguments))
@@ -24,7 +26,31 @@ Value Expr::Call::accept(Visitor& visitor)
     return visitor.visitCall(*this);
 }
 
-Expr::Grouping::Grouping(std::shared_ptr<Base> expression) :
+void Expr::Call::observe(const Value& callee)
+{
+    if (state_ != Quick::Uninitialized) {
+        return;
+    }
+    Quick kind = Quick::Generic;
+    if (callee.isObject()) {
+        switch (callee.getObject()->objectType()) {
+        case ObjectType::Function: kind = Quick::Function; break;
+        case ObjectType::Native:   kind = Quick::Native;   break;
+        default: break;
+        }
+    }
+    if (kind == Quick::Generic || (hits_ > 0 && kind != seen_)) {
+        state_ = Quick::Generic;
+        return;
+    }
+    seen_ = kind;
+    if (++hits_ >= quicken_after) {
+        state_ = kind;
+    }
+}
+
+Expr::Grouping::Grouping(Ptr expression) :
+    Base(AstNodeType::Grouping),
     expression_(std::move(expression))
 {
 }
@@ -34,7 +60,8 @@ Value Expr::Grouping::accept(Visitor& visitor)
     return visitor.visitGrouping(*this);
 }
 
-Expr::Ternary::Ternary(std::shared_ptr<Base> condition, std::shared_ptr<Base> ifTrue, std::shared_ptr<Base> ifFalse):
+Expr::Ternary::Ternary(Ptr condition, Ptr ifTrue, Ptr ifFalse):
+    Base(AstNodeType::Ternary),
     condition_(std::move(condition)),
     if_true_(std::move(ifTrue)),
     if_false_(std::move(ifFalse))
@@ -47,6 +74,7 @@ Value Expr::Ternary::accept(Visitor& visitor)
 }
 
 Expr::Binary::Binary(Expr::Base::Ptr left, Token oper, Expr::Base::Ptr right):
+    Base(AstNodeType::Binary),
     left_(std::move(left)),
     oper_(std::move(oper)),
     right_(std::move(right))
@@ -58,7 +86,38 @@ Value Expr::Binary::accept(Visitor& visitor)
     return visitor.visitBinary(*this);
 }
 
+void Expr::Binary::observe(const Value& left, const Value& right)
+{
+    Quick kind = Quick::Generic;
+    if (left.isNumber() && right.isNumber()) {
+        switch (oper_.type) {
+        case TokenType::Plus:         kind = Quick::NumberAdd;          break;
+        case TokenType::Minus:        kind = Quick::NumberSubtract;     break;
+        case TokenType::Star:         kind = Quick::NumberMultiply;     break;
+        case TokenType::Slash:        kind = Quick::NumberDivide;       break;
+        case TokenType::Less:         kind = Quick::NumberLess;         break;
+        case TokenType::LessEqual:    kind = Quick::NumberLessEqual;    break;
+        case TokenType::Greater:      kind = Quick::NumberGreater;      break;
+        case TokenType::GreaterEqual: kind = Quick::NumberGreaterEqual; break;
+        case TokenType::EqualEqual:   kind = Quick::NumberEqual;        break;
+        case TokenType::BangEqual:    kind = Quick::NumberNotEqual;     break;
+        default:;
+        }
+    } else if (oper_.type == TokenType::Plus && left.getType() == ValueType::String && right.getType() == ValueType::String) {
+        kind = Quick::StringConcat;
+    }
+    if (kind == Quick::Generic || (hits_ > 0 && kind != seen_)) {
+        quick_ = Quick::Generic;
+        return;
+    }
+    seen_ = kind;
+    if (++hits_ >= quicken_after) {
+        quick_ = kind;
+    }
+}
+
 Expr::Unary::Unary(Token oper, Expr::Base::Ptr operand):
+    Base(AstNodeType::Unary),
     oper_(std::move(oper)),
     operand_(std::move(operand))
 {
@@ -70,6 +129,7 @@ Value Expr::Unary::accept(Visitor& visitor)
 }
 
 Expr::Literal::Literal(Value value):
+    Base(AstNodeType::Literal),
     value_(std::move(value))
 {
 }
@@ -80,6 +140,7 @@ Value Expr::Literal::accept(Visitor& visitor)
 }
 
 Expr::Variable::Variable(Token name):
+    Base(AstNodeType::Variable),
     name_(std::move(name))
 {
 }
@@ -89,7 +150,8 @@ Value Expr::Variable::accept(Visitor& visitor)
     return visitor.visitVariable(*this);
 }
 
-Expr::Assign::Assign(Token name, std::shared_ptr<Base> value):
+Expr::Assign::Assign(Token name, Ptr value):
+    Base(AstNodeType::Assign),
     name_(std::move(name)),
     value_(std::move(value))
 {
@@ -100,7 +162,8 @@ Value Expr::Assign::accept(Visitor& visitor)
     return visitor.visitAssign(*this);
 }
 
-Expr::Lambda::Lambda(std::vector<Token> params, std::list<Stmt::Base::Ptr> body):
+Expr::Lambda::Lambda(std::vector<Token> params, std::vector<Stmt::Base::Ptr> body):
+    Base(AstNodeType::Function),
     params_(std::move(params)),
     body_(std::move(body))
 {
@@ -112,6 +175,7 @@ Value Expr::Lambda::accept(Visitor& visitor)
 }
 
 Expr::ThisKw::ThisKw(Token keyword):
+	Base(AstNodeType::ThisKw),
 	keyword_(std::move(keyword))
 {
 }
@@ -122,6 +186,7 @@ Value Expr::ThisKw::accept(Visitor& visitor)
 }
 
 Expr::Set::Set(Expr::Base::Ptr object, Token name, Expr::Base::Ptr value):
+	Base(AstNodeType::Set),
 	object_(std::move(object)),
 	name_(std::move(name)),
 	value_(std::move(value))
@@ -134,92 +199,101 @@ Value Expr::Set::accept(Visitor& visitor)
 }
 
 Stmt::Expression::Expression(Expr::Base::Ptr expr):
+    Base(AstNodeType::Expression),
     expr_(std::move(expr))
 {
 }
 
-void Stmt::Expression::accept(Visitor& visitor)
+Completion Stmt::Expression::accept(Visitor& visitor)
 {
-    visitor.visitExpression(*this);
+    return visitor.visitExpression(*this);
 }
 
-Stmt::Klass::Klass(Token name, std::vector<std::shared_ptr<Stmt::Function>> methods):
+Stmt::Klass::Klass(Token name, std::vector<Stmt::Function*> methods):
+    Base(AstNodeType::Klass),
     name_(std::move(name)),
     methods_(std::move(methods))
 {
 }
 
-void Stmt::Klass::accept(Visitor& visitor)
+Completion Stmt::Klass::accept(Visitor& visitor)
 {
-    visitor.visitKlass(*this);
+    return visitor.visitKlass(*this);
 }
 
 Stmt::Print::Print(Expr::Base::Ptr expr):
+    Base(AstNodeType::Print),
     expr_(std::move(expr))
 {
 }
 
-void Stmt::Print::accept(Visitor& visitor)
+Completion Stmt::Print::accept(Visitor& visitor)
 {
-    visitor.visitPrint(*this);
+    return visitor.visitPrint(*this);
 }
 
 Stmt::Var::Var(Token var, Expr::Base::Ptr expr):
+    Base(AstNodeType::Var),
     var_(std::move(var)),
     expr_(std::move(expr))
 {
 }
 
-void Stmt::Var::accept(Visitor& visitor)
+Completion Stmt::Var::accept(Visitor& visitor)
 {
-    visitor.visitVar(*this);
+    return visitor.visitVar(*this);
 }
 
-Stmt::Block::Block(std::list<Ptr> statements):
+Stmt::Block::Block(std::vector<Ptr> statements):
+    Base(AstNodeType::Block),
     statements_(std::move(statements))
 {
 }
 
-void Stmt::Block::accept(Visitor& visitor)
+Completion Stmt::Block::accept(Visitor& visitor)
 {
-    visitor.visitBlock(*this);
+    return visitor.visitBlock(*this);
 }
 
 Stmt::IfStmt::IfStmt(Expr::Base::Ptr condition, Stmt::Base::Ptr thenBranch, Stmt::Base::Ptr elseBranch):
+    Base(AstNodeType::IfStmt),
     condition_(std::move(condition)),
     then_branch_(std::move(thenBranch)),
     else_branch_(std::move(elseBranch))
 {
 }
 
-void Stmt::IfStmt::accept(Visitor& visitor)
+Completion Stmt::IfStmt::accept(Visitor& visitor)
 {
-    visitor.visitIfStmt(*this);
+    return visitor.visitIfStmt(*this);
 }
 
 Stmt::While::While(Expr::Base::Ptr condition, Stmt::Base::Ptr body):
+    Base(AstNodeType::While),
     condition_(std::move(condition)),
     body_(std::move(body))
 {
 }
 
-void Stmt::While::accept(Visitor& visitor)
+Completion Stmt::While::accept(Visitor& visitor)
 {
-    visitor.visitWhile(*this);
+    return visitor.visitWhile(*this);
 }
 
 Stmt::LoopControl::LoopControl(Token controller):
+    Base(AstNodeType::Controller),
     controller_(std::move(controller))
 {
 }
 
-void Stmt::LoopControl::accept(Visitor& visitor)
+Completion Stmt::LoopControl::accept(Visitor& visitor)
 {
-    visitor.visitControl(*this);
+    return visitor.visitControl(*this);
 }
 
 Stmt::ForLoop::ForLoop(Stmt::Base::Ptr initializer, Expr::Base::Ptr condition, Stmt::Base::Ptr increment,
     Stmt::Base::Ptr body):
+    Base(AstNodeType::ForLoop),
     initializer_(std::move(initializer)),
     condition_(std::move(condition)),
     increment_(std::move(increment)),
@@ -227,30 +301,32 @@ Stmt::ForLoop::ForLoop(Stmt::Base::Ptr initializer, Expr::Base::Ptr condition, S
 {
 }
 
-void Stmt::ForLoop::accept(Visitor& visitor)
+Completion Stmt::ForLoop::accept(Visitor& visitor)
 {
-    visitor.visitForLoop(*this);
+    return visitor.visitForLoop(*this);
 }
 
-Stmt::Function::Function(Token name, std::vector<Token> params, std::list<Stmt::Base::Ptr> body):
+Stmt::Function::Function(Token name, std::vector<Token> params, std::vector<Stmt::Base::Ptr> body):
+    Base(AstNodeType::Function),
     name_(std::move(name)),
     params_(std::move(params)),
     body_(std::move(body))
 {
 }
 
-void Stmt::Function::accept(Visitor& visitor)
+Completion Stmt::Function::accept(Visitor& visitor)
 {
-    visitor.visitFunction(this);
+    return visitor.visitFunction(this);
 }
 
 Stmt::Return::Return(Token keyword, Expr::Base::Ptr value):
+    Base(AstNodeType::Return),
     keyword_(std::move(keyword)),
     value_(std::move(value))
 {
 }
 
-void Stmt::Return::accept(Visitor& visitor)
+Completion Stmt::Return::accept(Visitor& visitor)
 {
-    visitor.visitReturn(*this);
+    return visitor.visitReturn(*this);
 }
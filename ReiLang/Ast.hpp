@@ -1,16 +1,55 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include "Token.hpp"
 #include "Value.hpp"
-#include <list>
+#include "Shape.hpp"
 #include <vector>
 
+class Optimizer;
+
 enum class AstNodeType
 {
     Call, Grouping, Binary, Ternary, Unary, Literal, Variable, Assign, ThisKw,
     Expression, Print, Var, Block, IfStmt, While, Controller, ForLoop, Function, Return, Klass, Get, Set
 };
 
+//
+// Where the Resolver has found a variable: a slot of an enclosing local scope or the global scope.
+//
+struct VarSlot
+{
+    static constexpr unsigned int global = ~0u;
+
+    unsigned int distance = global;
+    unsigned int index    = 0;
+
+    [[nodiscard]] bool isGlobal() const { return distance == global; }
+};
+
+//
+// How a statement has finished: normally, or unwinding to the enclosing loop or function.
+// Returned up through the visitors instead of throwing.
+//
+struct Completion
+{
+    enum class Type
+    {
+        Normal, Break, Continue, Return
+    };
+
+    Type  type = Type::Normal;
+    Value value{};
+
+    [[nodiscard]] bool isNormal() const { return type == Type::Normal; }
+};
+
+//
+// Nodes of the tree-walker quicken: after seeing the same kind of operands this many times in a row
+// they switch to a specialized path, and fall back to the generic one for good on the first mismatch.
+//
+constexpr unsigned int quicken_after = 2;
+
 namespace Expr { // Base class here
 
 class Visitor;
@@ -18,10 +57,15 @@ class Visitor;
 class Base
 {
 public:
-    typedef std::shared_ptr<Base> Ptr;
+    typedef Base* Ptr;
     virtual ~Base() = default;
     virtual Value accept(Visitor& visitor) = 0;
-    [[nodiscard]] virtual AstNodeType type() const = 0;
+    // stored rather than virtual, so the interpreter can switch on it without an indirect call
+    [[nodiscard]] AstNodeType type() const { return type_; }
+protected:
+    explicit Base(const AstNodeType type) : type_(type) {}
+private:
+    AstNodeType type_;
 };
 
 }
@@ -33,10 +77,19 @@ class Visitor;
 class Base
 {
 public:
-    typedef std::shared_ptr<Base> Ptr;
+    typedef Base* Ptr;
     virtual ~Base() = default;
-    virtual void accept(Visitor& visitor) = 0;
-    [[nodiscard]] virtual AstNodeType type() const = 0;
+    virtual Completion accept(Visitor& visitor) = 0;
+    // stored rather than virtual, so the interpreter can switch on it without an indirect call
+    [[nodiscard]] AstNodeType type() const { return type_; }
+    // where the statement starts, 0 for those the parser did not write
+    [[nodiscard]] unsigned int line() const { return line_; }
+    void locate(const unsigned int line) { line_ = line; }
+protected:
+    explicit Base(const AstNodeType type) : type_(type) {}
+private:
+    AstNodeType  type_;
+    unsigned int line_ = 0;
 };
 
 }
@@ -49,48 +102,55 @@ public:
 	explicit ThisKw(Token keyword);
 	Value accept(Visitor& visitor) override;
 
-	[[nodiscard]] Token keyword() const { return keyword_; }
-
-	[[nodiscard]] AstNodeType type() const override { return AstNodeType::ThisKw; }
+	[[nodiscard]] Token          keyword() const { return keyword_; }
+	[[nodiscard]] const VarSlot& slot()    const { return slot_;    }
+	void resolve(const VarSlot& slot) { slot_ = slot; }
 private:
-	Token keyword_;
+	Token   keyword_;
+	VarSlot slot_;
 };
 	
 class Set : public Base
 {
 public:
+	friend class ::Optimizer;
+
 	Set(Expr::Base::Ptr object, Token name, Expr::Base::Ptr value);
 	Value accept(Visitor& visitor) override;
 
 	[[nodiscard]] Expr::Base::Ptr object() const { return object_; }
 	[[nodiscard]] Token           name()   const { return name_; }
 	[[nodiscard]] Expr::Base::Ptr value()  const { return value_; }
-
-	[[nodiscard]] AstNodeType type() const override { return AstNodeType::Set; }
+	[[nodiscard]] PropertyCache&  cache()        { return cache_; }
 private:
 	Expr::Base::Ptr object_;
 	Token			name_;
 	Expr::Base::Ptr value_;
+	PropertyCache   cache_;
 };
 	
 class Get : public Base
 {
 public:
+	friend class ::Optimizer;
+
 	Get(Expr::Base::Ptr object, Token name);
 	Value accept(Visitor& visitor) override;
 
-	[[nodiscard]] Ptr   object() const { return object_; }
-	[[nodiscard]] Token name()   const { return name_;   }
-
-	[[nodiscard]] AstNodeType type() const override { return AstNodeType::Get; }
+	[[nodiscard]] Ptr            object() const { return object_; }
+	[[nodiscard]] Token          name()   const { return name_;   }
+	[[nodiscard]] PropertyCache& cache()        { return cache_;  }
 private:
 	Expr::Base::Ptr object_;
 	Token           name_;
+	PropertyCache   cache_;
 };
 
 class Call : public Base
 {
 public:
+    friend class ::Optimizer;
+
     Call(Expr::Base::Ptr callee, Token paren, std::vector<Expr::Base::Ptr> arguments);
     Value accept(Visitor& visitor) override;
 
@@ -98,73 +158,102 @@ public:
     [[nodiscard]] Token                   paren()    const { return paren_;     }
     [[nodiscard]] const std::vector<Ptr>& argument() const { return arguments_; }
 
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Call; }
+    // the callee has always been a tree-walker function or always a native, see Interpreter::visitCall
+    [[nodiscard]] bool calleeIsFunction() const { return state_ == Quick::Function; }
+    [[nodiscard]] bool calleeIsNative()   const { return state_ == Quick::Native;   }
+    void observe(const Value& callee);
+    void despecialize() { state_ = Quick::Generic; }
 private:
+    enum class Quick : std::uint8_t
+    {
+        Uninitialized, Generic, Function, Native
+    };
+
     Expr::Base::Ptr              callee_;
     Token                        paren_;
     std::vector<Expr::Base::Ptr> arguments_;
+    Quick                        state_ = Quick::Uninitialized;
+    Quick                        seen_  = Quick::Uninitialized;
+    std::uint8_t                 hits_  = 0;
 };
 
 class Grouping : public Base
 {
 public:
-    explicit Grouping(std::shared_ptr<Base> expression);
-    Value accept(Visitor& visitor) override;
+    friend class ::Optimizer;
 
-    [[nodiscard]] std::shared_ptr<Base> expression() const { return expression_; }
+    explicit Grouping(Ptr expression);
+    Value accept(Visitor& visitor) override;
 
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Grouping; }
+    [[nodiscard]] Ptr expression() const { return expression_; }
 private:
-    std::shared_ptr<Base> expression_;
+    Ptr expression_;
 };
 
 class Ternary : public Base
 {
 public:
-    Ternary(std::shared_ptr<Base> condition, std::shared_ptr<Base> ifTrue, std::shared_ptr<Base> ifFalse);
-    Value accept(Visitor& visitor) override;
+    friend class ::Optimizer;
 
-    [[nodiscard]] std::shared_ptr<Base> condition() const { return condition_; }
-    [[nodiscard]] std::shared_ptr<Base> ifTrue()    const { return if_true_;   }
-    [[nodiscard]] std::shared_ptr<Base> ifFalse()   const { return if_false_;  }
+    Ternary(Ptr condition, Ptr ifTrue, Ptr ifFalse);
+    Value accept(Visitor& visitor) override;
 
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Ternary; }
+    [[nodiscard]] Ptr condition() const { return condition_; }
+    [[nodiscard]] Ptr ifTrue()    const { return if_true_;   }
+    [[nodiscard]] Ptr ifFalse()   const { return if_false_;  }
 private:
-    std::shared_ptr<Base> condition_;
-    std::shared_ptr<Base> if_true_;
-    std::shared_ptr<Base> if_false_;
+    Ptr condition_;
+    Ptr if_true_;
+    Ptr if_false_;
 };
 
 class Binary : public Base
 {
 public:
+    friend class ::Optimizer;
+
     Binary(Expr::Base::Ptr left, Token oper, Expr::Base::Ptr right);
     Value accept(Visitor& visitor) override;
 
-    [[nodiscard]] std::shared_ptr<Base> left()  const { return left_;  }
-    [[nodiscard]] Token                 oper()  const { return oper_;  }
-    [[nodiscard]] std::shared_ptr<Base> right() const { return right_; }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Binary; }
+    // what the node has specialized to, see Interpreter::visitBinary
+    enum class Quick : std::uint8_t
+    {
+        Uninitialized, Generic, StringConcat,
+        NumberAdd, NumberSubtract, NumberMultiply, NumberDivide,
+        NumberLess, NumberLessEqual, NumberGreater, NumberGreaterEqual, NumberEqual, NumberNotEqual
+    };
+
+    [[nodiscard]] Ptr   left()  const { return left_;  }
+    [[nodiscard]] Token oper()  const { return oper_;  }
+    [[nodiscard]] Ptr   right() const { return right_; }
+
+    [[nodiscard]] Quick quick()       const { return quick_; }
+    [[nodiscard]] bool  specialized() const { return quick_ > Quick::Generic; }
+    // profiles the operands of a generic evaluation
+    void observe(const Value& left, const Value& right);
+    void despecialize() { quick_ = Quick::Generic; }
 private:
-    std::shared_ptr<Base> left_;
-    Token                 oper_;
-    std::shared_ptr<Base> right_;
+    Ptr          left_;
+    Token        oper_;
+    Ptr          right_;
+    Quick        quick_ = Quick::Uninitialized;
+    Quick        seen_  = Quick::Uninitialized;
+    std::uint8_t hits_  = 0;
 };
 
 class Unary : public Base
 {
 public:
+    friend class ::Optimizer;
+
     Unary(Token oper, Expr::Base::Ptr operand);
     Value accept(Visitor& visitor) override;
 
-    [[nodiscard]] Token                 oper()    const { return oper_;    }
-    [[nodiscard]] std::shared_ptr<Base> operand() const { return operand_; }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Unary; }
+    [[nodiscard]] Token oper()    const { return oper_;    }
+    [[nodiscard]] Ptr   operand() const { return operand_; }
 private:
-    Token                 oper_;
-    std::shared_ptr<Base> operand_;
+    Token oper_;
+    Ptr   operand_;
 };
 
 class Literal : public Base
@@ -174,8 +263,6 @@ public:
     Value accept(Visitor& visitor) override;
 
     [[nodiscard]] Value value() const { return value_; }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Literal; }
 private:
     Value value_;
 };
@@ -186,41 +273,59 @@ public:
     explicit Variable(Token name);
     Value accept(Visitor& visitor) override;
 
-    [[nodiscard]] Token name() const { return name_; }
+    [[nodiscard]] Token          name() const { return name_; }
+    [[nodiscard]] const VarSlot& slot() const { return slot_; }
+    void resolve(const VarSlot& slot) { slot_ = slot; }
 
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Variable; }
+    // a global once found stays at the same address in the global scope, so it is looked up by name once
+    [[nodiscard]] Value* global() const { return global_; }
+    void cache(Value* global) { global_ = global; }
 private:
-    Token name_;
+    Token   name_;
+    VarSlot slot_;
+    Value*  global_ = nullptr;
 };
 
 class Assign : public Base
 {
 public:
-    Assign(Token name, std::shared_ptr<Base> value);
+    friend class ::Optimizer;
+
+    Assign(Token name, Ptr value);
     Value accept(Visitor& visitor) override;
 
-    [[nodiscard]] Token                 name()  const { return name_;  }
-    [[nodiscard]] std::shared_ptr<Base> value() const { return value_; }
+    [[nodiscard]] Token          name()  const { return name_;  }
+    [[nodiscard]] Ptr            value() const { return value_; }
+    [[nodiscard]] const VarSlot& slot()  const { return slot_;  }
+    void resolve(const VarSlot& slot) { slot_ = slot; }
 
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Assign; }
+    // same as Variable::global
+    [[nodiscard]] Value* global() const { return global_; }
+    void cache(Value* global) { global_ = global; }
 private:
-    Token name_;
-    std::shared_ptr<Base> value_;
+    Token   name_;
+    Ptr     value_;
+    VarSlot slot_;
+    Value*  global_ = nullptr;
 };
 
 class Lambda : public Base
 {
 public:
-    Lambda(std::vector<Token> params, std::list<Stmt::Base::Ptr> body);
-    Value accept(Visitor& visitor) override;
+    friend class ::Optimizer;
 
-    [[nodiscard]] const std::vector<Token>&         params() const { return params_; }
-    [[nodiscard]] const std::list<Stmt::Base::Ptr>& body()   const { return body_;   }
+    Lambda(std::vector<Token> params, std::vector<Stmt::Base::Ptr> body);
+    Value accept(Visitor& visitor) override;
 
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Function; }
+    [[nodiscard]] const std::vector<Token>&           params() const { return params_; }
+    [[nodiscard]] const std::vector<Stmt::Base::Ptr>& body()   const { return body_;   }
+    // whether a closure created in the body may outlive a call, see ScopeStack
+    [[nodiscard]] bool captured() const { return captured_; }
+    void capture() { captured_ = true; }
 private:
-    std::vector<Token> params_;
-    std::list<Stmt::Base::Ptr> body_;
+    std::vector<Token>           params_;
+    std::vector<Stmt::Base::Ptr> body_;
+    bool                         captured_ = false;
 };
 
 class Visitor
@@ -253,12 +358,12 @@ namespace Stmt {
 class Expression : public Base
 {
 public:
+    friend class ::Optimizer;
+
     explicit Expression(Expr::Base::Ptr expr);
-    void accept(Visitor& visitor) override;
+    Completion accept(Visitor& visitor) override;
 
     [[nodiscard]] Expr::Base::Ptr expr() const { return expr_; }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Expression; }
 private:
     Expr::Base::Ptr expr_;
 };
@@ -266,12 +371,12 @@ private:
 class Print : public Base
 {
 public:
+    friend class ::Optimizer;
+
     explicit Print(Expr::Base::Ptr expr);
-    void accept(Visitor& visitor) override;
+    Completion accept(Visitor& visitor) override;
 
     [[nodiscard]] Expr::Base::Ptr expr() const { return expr_; }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Print; }
 private:
     Expr::Base::Ptr expr_;
 };
@@ -279,42 +384,49 @@ private:
 class Var : public Base
 {
 public:
+    friend class ::Optimizer;
+
     Var(Token var, Expr::Base::Ptr expr);
-    void accept(Visitor& visitor) override;
+    Completion accept(Visitor& visitor) override;
 
-    [[nodiscard]] Token                       var()  const { return var_;  }
+    [[nodiscard]] Token           var()  const { return var_;  }
     [[nodiscard]] Expr::Base::Ptr expr() const { return expr_; }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Var; }
+    [[nodiscard]] const VarSlot&  slot() const { return slot_; }
+    void resolve(const VarSlot& slot) { slot_ = slot; }
 private:
-    Token var_;
+    Token           var_;
     Expr::Base::Ptr expr_;
+    VarSlot         slot_;
 };
 
 class Block : public Base
 {
 public:
-    explicit Block(std::list<Ptr> statements);
-    void accept(Visitor& visitor) override;
+    friend class ::Optimizer;
 
-    [[nodiscard]] const std::list<Ptr>& statements() const { return statements_; }
+    explicit Block(std::vector<Ptr> statements);
+    Completion accept(Visitor& visitor) override;
 
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Block; }
+    [[nodiscard]] const std::vector<Ptr>& statements() const { return statements_; }
+    // whether a closure created in the block may outlive it, see ScopeStack
+    [[nodiscard]] bool captured() const { return captured_; }
+    void capture() { captured_ = true; }
 private:
-    std::list<Ptr> statements_;
+    std::vector<Ptr> statements_;
+    bool             captured_ = false;
 };
 
 class IfStmt : public Base
 {
 public:
+    friend class ::Optimizer;
+
     IfStmt(Expr::Base::Ptr condition, Stmt::Base::Ptr thenBranch, Stmt::Base::Ptr elseBranch);
-    void accept(Visitor& visitor) override;
+    Completion accept(Visitor& visitor) override;
 
     [[nodiscard]] Expr::Base::Ptr condition()  const { return condition_;   }
     [[nodiscard]] Stmt::Base::Ptr thenBranch() const { return then_branch_; }
     [[nodiscard]] Stmt::Base::Ptr elseBranch() const { return else_branch_; }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::IfStmt; }
 private:
     Expr::Base::Ptr condition_;
     Stmt::Base::Ptr then_branch_;
@@ -324,13 +436,13 @@ private:
 class While : public Base
 {
 public:
+    friend class ::Optimizer;
+
     While(Expr::Base::Ptr condition, Stmt::Base::Ptr body);
-    void accept(Visitor& visitor) override;
+    Completion accept(Visitor& visitor) override;
 
     [[nodiscard]] Expr::Base::Ptr condition() const { return condition_; }
     [[nodiscard]] Stmt::Base::Ptr body()      const { return body_;      }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::While; }
 private:
     Expr::Base::Ptr condition_;
     Stmt::Base::Ptr body_;
@@ -340,11 +452,9 @@ class LoopControl : public Base
 {
 public:
     explicit LoopControl(Token controller);
-    void accept(Visitor& visitor) override;
+    Completion accept(Visitor& visitor) override;
 
     [[nodiscard]] Token controller() const { return controller_; }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Controller; }
 private:
     Token controller_;
 };
@@ -357,15 +467,15 @@ private:
 class ForLoop : public Base
 {
 public:
+    friend class ::Optimizer;
+
     ForLoop(Stmt::Base::Ptr initializer, Expr::Base::Ptr condition, Stmt::Base::Ptr increment, Stmt::Base::Ptr body);
-    void accept(Visitor& visitor) override;
+    Completion accept(Visitor& visitor) override;
 
     [[nodiscard]] Stmt::Base::Ptr initializer() const { return initializer_; }
     [[nodiscard]] Expr::Base::Ptr condition()   const { return condition_;   }
     [[nodiscard]] Stmt::Base::Ptr increment()   const { return increment_;   }
     [[nodiscard]] Stmt::Base::Ptr body()        const { return body_;        }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::ForLoop; }
 private:
     Stmt::Base::Ptr initializer_;
     Expr::Base::Ptr condition_;
@@ -376,47 +486,55 @@ private:
 class Function : public Base
 {
 public:
-    Function(Token name, std::vector<Token> params, std::list<Stmt::Base::Ptr> body);
-    void accept(Visitor& visitor) override;
+    friend class ::Optimizer;
 
-    [[nodiscard]] Token                   name()   const { return name_;   }
-    [[nodiscard]] const std::vector<Token>& params() const { return params_; }
-    [[nodiscard]] const std::list<Ptr>&   body()   const { return body_;   }
+    Function(Token name, std::vector<Token> params, std::vector<Stmt::Base::Ptr> body);
+    Completion accept(Visitor& visitor) override;
 
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Function; }
+    [[nodiscard]] Token                     name()   const { return name_;   }
+    [[nodiscard]] const std::vector<Token>& params() const { return params_; }
+    [[nodiscard]] const std::vector<Ptr>&   body()   const { return body_;   }
+    [[nodiscard]] const VarSlot&            slot()   const { return slot_;   }
+    void resolve(const VarSlot& slot) { slot_ = slot; }
+    // whether a closure created in the body may outlive a call, see ScopeStack
+    [[nodiscard]] bool captured() const { return captured_; }
+    void capture() { captured_ = true; }
 private:
-    Token name_;
-    std::vector<Token> params_;
-    std::list<Stmt::Base::Ptr> body_;
+    Token                        name_;
+    std::vector<Token>           params_;
+    std::vector<Stmt::Base::Ptr> body_;
+    VarSlot                      slot_;
+    bool                         captured_ = false;
 };
 
 class Klass : public Base
 {
 public:
-	Klass(Token name, std::vector<std::shared_ptr<Stmt::Function>> methods);
-	void accept(Visitor& visitor) override;
+	Klass(Token name, std::vector<Stmt::Function*> methods);
+	Completion accept(Visitor& visitor) override;
 
-	[[nodiscard]] Token                                               name()    const { return name_;    }
-	[[nodiscard]] const std::vector<std::shared_ptr<Stmt::Function>>& methods() const { return methods_; }
-
-	[[nodiscard]] AstNodeType type() const override { return AstNodeType::Klass; }
+	[[nodiscard]] Token                               name()    const { return name_;    }
+	[[nodiscard]] const std::vector<Stmt::Function*>& methods() const { return methods_; }
+	[[nodiscard]] const VarSlot&                      slot()    const { return slot_;    }
+	void resolve(const VarSlot& slot) { slot_ = slot; }
 private:
-	Token                                         name_;
-	std::vector<std::shared_ptr<Stmt::Function>>  methods_;
+	Token                        name_;
+	std::vector<Stmt::Function*> methods_;
+	VarSlot                      slot_;
 };
 
 class Return : public Base
 {
 public:
+    friend class ::Optimizer;
+
     Return(Token keyword, Expr::Base::Ptr value);
-    void accept(Visitor& visitor) override;
+    Completion accept(Visitor& visitor) override;
 
     [[nodiscard]] Token           keyword() const { return keyword_; }
     [[nodiscard]] Expr::Base::Ptr value()   const { return value_;   }
-
-    [[nodiscard]] AstNodeType type() const override { return AstNodeType::Return; }
 private:
-    Token keyword_;
+    Token           keyword_;
     Expr::Base::Ptr value_;
 };
 
@@ -429,17 +547,17 @@ public:
     Visitor& operator = (const Visitor&) = delete;
     Visitor& operator = (Visitor&&)      = delete;
     virtual ~Visitor()                   = default;
-    virtual void visitExpression(Expression&) = 0;
-    virtual void visitPrint(Print&)           = 0;
-    virtual void visitVar(Var&)               = 0;
-    virtual void visitBlock(Block&)           = 0;
-    virtual void visitIfStmt(IfStmt&)         = 0;
-    virtual void visitWhile(While&)           = 0;
-    virtual void visitControl(LoopControl&)   = 0;
-    virtual void visitForLoop(ForLoop&)       = 0;
-    virtual void visitFunction(Function*)     = 0;
-    virtual void visitReturn(Return&)         = 0;
-    virtual void visitKlass(Klass&)           = 0;
+    virtual Completion visitExpression(Expression&) = 0;
+    virtual Completion visitPrint(Print&)           = 0;
+    virtual Completion visitVar(Var&)               = 0;
+    virtual Completion visitBlock(Block&)           = 0;
+    virtual Completion visitIfStmt(IfStmt&)         = 0;
+    virtual Completion visitWhile(While&)           = 0;
+    virtual Completion visitControl(LoopControl&)   = 0;
+    virtual Completion visitForLoop(ForLoop&)       = 0;
+    virtual Completion visitFunction(Function*)     = 0;
+    virtual Completion visitReturn(Return&)         = 0;
+    virtual Completion visitKlass(Klass&)           = 0;
 };
 
 }
@@ -0,0 +1,7 @@
+#include "Callable.hpp"
+#include "Interpreter.hpp"
+
+Value Callable::invoke(Interpreter& interpreter, Instance* receiver, const Args args)
+{
+    return bind(interpreter.heap(), receiver)->call(interpreter, args);
+}
@@ -3,12 +3,39 @@
 #include <vector>
 
 class Interpreter;
+class Heap;
 
-class Callable
+//
+// Arguments of a call: a view over values evaluated in place on the caller's stack.
+// Valid until the callee runs script code of its own, so callees copy out what they keep.
+//
+class Args
 {
 public:
-    virtual ~Callable() = default;
+    Args() = default;
+    Args(const Value* data, const size_t size) : data_(data), size_(size) {}
+
+    [[nodiscard]] size_t       size()  const { return size_;  }
+    [[nodiscard]] bool         empty() const { return size_ == 0; }
+    [[nodiscard]] const Value* begin() const { return data_; }
+    [[nodiscard]] const Value* end()   const { return data_ + size_; }
+    [[nodiscard]] const Value& front() const { return data_[0]; }
+    [[nodiscard]] const Value& operator [] (const size_t i) const { return data_[i]; }
+private:
+    const Value* data_ = nullptr;
+    size_t       size_ = 0;
+};
+
+class Callable : public Object
+{
+public:
+    explicit Callable(ObjectType type = ObjectType::Callable) : Object(type) {}
     [[nodiscard]] virtual unsigned int arity() const = 0;
-    virtual Value call(Interpreter& interpreter, std::vector<Value> args) = 0;
+    // the caller has checked the arity
+    virtual Value call(Interpreter& interpreter, Args args) = 0;
     [[nodiscard]] virtual std::string toString() const = 0;
+    // methods return a copy bound to the instance, plain callables are returned as is
+    [[nodiscard]] virtual Callable* bind(Heap& /*heap*/, Instance* /*instance*/) { return this; }
+    // calls a method on the receiver, by default through a bound copy
+    virtual Value invoke(Interpreter& interpreter, Instance* receiver, Args args);
 };
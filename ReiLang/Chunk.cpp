@@ -0,0 +1,104 @@
+#include "Chunk.hpp"
+
+#include <cstring>
+
+const char* to_string(OpCode e)
+{
+    switch (e) {
+    case OpCode::Constant     : return "Constant";
+    case OpCode::Nil          : return "Nil";
+    case OpCode::True         : return "True";
+    case OpCode::False        : return "False";
+    case OpCode::Pop          : return "Pop";
+    case OpCode::GetLocal     : return "GetLocal";
+    case OpCode::SetLocal     : return "SetLocal";
+    case OpCode::GetGlobal    : return "GetGlobal";
+    case OpCode::DefineGlobal : return "DefineGlobal";
+    case OpCode::SetGlobal    : return "SetGlobal";
+    case OpCode::GetUpvalue   : return "GetUpvalue";
+    case OpCode::SetUpvalue   : return "SetUpvalue";
+    case OpCode::GetProperty  : return "GetProperty";
+    case OpCode::SetProperty  : return "SetProperty";
+    case OpCode::Equal        : return "Equal";
+    case OpCode::NotEqual     : return "NotEqual";
+    case OpCode::Greater      : return "Greater";
+    case OpCode::GreaterEqual : return "GreaterEqual";
+    case OpCode::Less         : return "Less";
+    case OpCode::LessEqual    : return "LessEqual";
+    case OpCode::Add          : return "Add";
+    case OpCode::Subtract     : return "Subtract";
+    case OpCode::Multiply     : return "Multiply";
+    case OpCode::Divide       : return "Divide";
+    case OpCode::Not          : return "Not";
+    case OpCode::Negate       : return "Negate";
+    case OpCode::Print        : return "Print";
+    case OpCode::Jump         : return "Jump";
+    case OpCode::JumpIfFalse  : return "JumpIfFalse";
+    case OpCode::Loop         : return "Loop";
+    case OpCode::Call         : return "Call";
+    case OpCode::Invoke       : return "Invoke";
+    case OpCode::Closure      : return "Closure";
+    case OpCode::CloseUpvalue : return "CloseUpvalue";
+    case OpCode::Return       : return "Return";
+    case OpCode::Class        : return "Class";
+    case OpCode::Method       : return "Method";
+    default : return "unknown";
+    }
+}
+
+void Chunk::write(const std::uint8_t byte, const unsigned int line)
+{
+    code_.push_back(byte);
+    lines_.push_back(line);
+}
+
+void Chunk::write(const OpCode op, const unsigned int line)
+{
+    write(static_cast<std::uint8_t>(op), line);
+}
+
+void Chunk::writeShort(const std::uint16_t value, const unsigned int line)
+{
+    write(static_cast<std::uint8_t>(value >> 8), line);
+    write(static_cast<std::uint8_t>(value & 0xff), line);
+}
+
+void Chunk::patchShort(const size_t offset, const std::uint16_t value)
+{
+    code_[offset]     = static_cast<std::uint8_t>(value >> 8);
+    code_[offset + 1] = static_cast<std::uint8_t>(value & 0xff);
+}
+
+size_t Chunk::addConstant(const Value& value)
+{
+    if (value.isNumber()) {
+        // by bit pattern, since -0 equals 0 and NaN equals nothing
+        const double number = value.getNumber();
+        std::uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        const auto found = numbers_.find(bits);
+        if (found != numbers_.end()) {
+            return found->second;
+        }
+        numbers_.insert({ bits, constants_.size() });
+    } else if (value.getType() == ValueType::String) {
+        const auto found = strings_.find(value.getString());
+        if (found != strings_.end()) {
+            return found->second;
+        }
+        strings_.insert({ value.getString(), constants_.size() });
+    }
+    constants_.push_back(value);
+    return constants_.size() - 1;
+}
+
+size_t Chunk::addCache()
+{
+    caches_.emplace_back();
+    return caches_.size() - 1;
+}
+
+unsigned Chunk::line(const size_t offset) const
+{
+    return offset < lines_.size() ? lines_[offset] : 0;
+}
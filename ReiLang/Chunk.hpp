@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Value.hpp"
+#include "Shape.hpp"
+
+enum class OpCode : std::uint8_t
+{
+    Constant,       // u16 constant
+    Nil,
+    True,
+    False,
+    Pop,
+    GetLocal,       // u8 slot
+    SetLocal,       // u8 slot
+    GetGlobal,      // u16 global
+    DefineGlobal,   // u16 global
+    SetGlobal,      // u16 global
+    GetUpvalue,     // u8 upvalue
+    SetUpvalue,     // u8 upvalue
+    GetProperty,    // u16 name constant, u16 cache
+    SetProperty,    // u16 name constant, u16 cache
+    Equal,
+    NotEqual,
+    Greater,
+    GreaterEqual,
+    Less,
+    LessEqual,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Not,
+    Negate,
+    Print,
+    Jump,           // u16 forward offset
+    JumpIfFalse,    // u16 forward offset, keeps the condition on the stack
+    Loop,           // u16 backward offset
+    Call,           // u8 argument count
+    Invoke,         // u16 method name constant, u16 cache, u8 argument count
+    Closure,        // u16 prototype constant, then (u8 is local, u8 index) per upvalue
+    CloseUpvalue,
+    Return,
+    Class,          // u16 name constant
+    Method          // u16 name constant
+};
+
+const char* to_string(OpCode e);
+
+//
+// Compiled code of a single function: instructions, their source lines and the constant pool.
+//
+class Chunk
+{
+public:
+    void write(std::uint8_t byte, unsigned int line);
+    void write(OpCode op, unsigned int line);
+    void writeShort(std::uint16_t value, unsigned int line);
+    void patchShort(size_t offset, std::uint16_t value);
+
+    // returns the index of an equal constant if there is one already
+    [[nodiscard]] size_t addConstant(const Value& value);
+    // inline cache for one property access instruction
+    [[nodiscard]] size_t addCache();
+
+    [[nodiscard]] const std::vector<std::uint8_t>& code()      const { return code_;      }
+    [[nodiscard]] const std::vector<Value>&        constants() const { return constants_; }
+    [[nodiscard]] unsigned int                     line(size_t offset) const;
+    [[nodiscard]] size_t                           size()      const { return code_.size(); }
+    [[nodiscard]] PropertyCache*                   caches()          { return caches_.data(); }
+private:
+    std::vector<std::uint8_t>                 code_;
+    std::vector<unsigned int>                 lines_;
+    std::vector<Value>                        constants_;
+    std::vector<PropertyCache>                caches_;
+    std::unordered_map<std::string, size_t>   strings_;
+    std::unordered_map<std::uint64_t, size_t> numbers_;
+};
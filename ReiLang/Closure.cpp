@@ -0,0 +1,100 @@
+#include "Closure.hpp"
+#include "Instance.hpp"
+#include "Interpreter.hpp"
+#include "Vm.hpp"
+
+Prototype::Prototype(std::string name, const unsigned arity):
+    Object(ObjectType::Prototype),
+    name_(std::move(name)),
+    arity_(arity),
+    upvalue_count_(0)
+{
+}
+
+void Prototype::trace(Heap& heap)
+{
+    for (auto& constant : chunk_.constants()) {
+        heap.mark(constant);
+    }
+}
+
+Upvalue::Upvalue(Value* slot):
+    Object(ObjectType::Upvalue),
+    location(slot),
+    next(nullptr)
+{
+}
+
+void Upvalue::trace(Heap& heap)
+{
+    heap.mark(closed);
+}
+
+void Upvalue::close()
+{
+    closed = *location;
+    location = &closed;
+}
+
+Closure::Closure(Prototype* prototype):
+    Callable(ObjectType::Closure),
+    prototype_(prototype),
+    upvalues_(prototype->upvalueCount(), nullptr)
+{
+}
+
+void Closure::trace(Heap& heap)
+{
+    heap.mark(prototype_);
+    for (auto* upvalue : upvalues_) {
+        heap.mark(upvalue);
+    }
+}
+
+unsigned Closure::arity() const
+{
+    return prototype_->arity();
+}
+
+Value Closure::call(Interpreter& interpreter, const Args args)
+{
+    return interpreter.vm()->invoke(Value{ static_cast<Callable*>(this) }, args);
+}
+
+std::string Closure::toString() const
+{
+    return prototype_->name() + " :: t -> t1";
+}
+
+Callable* Closure::bind(Heap& heap, Instance* instance)
+{
+    return heap.allocate<BoundMethod>(instance, this);
+}
+
+BoundMethod::BoundMethod(Instance* receiver, Closure* method):
+    Callable(ObjectType::BoundMethod),
+    receiver_(receiver),
+    method_(method)
+{
+}
+
+void BoundMethod::trace(Heap& heap)
+{
+    heap.mark(receiver_);
+    heap.mark(method_);
+}
+
+unsigned BoundMethod::arity() const
+{
+    return method_->arity();
+}
+
+Value BoundMethod::call(Interpreter& interpreter, const Args args)
+{
+    return interpreter.vm()->invoke(Value{ static_cast<Callable*>(this) }, args);
+}
+
+std::string BoundMethod::toString() const
+{
+    return method_->toString();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Callable.hpp"
+#include "Chunk.hpp"
+
+//
+// Objects of the bytecode engine.
+//
+
+// compiled function body shared by all of its closures
+class Prototype final : public Object
+{
+public:
+    Prototype(std::string name, unsigned int arity);
+    void trace(Heap& heap) override;
+
+    [[nodiscard]] Chunk&             chunk()              { return chunk_;         }
+    [[nodiscard]] const std::string& name()         const { return name_;          }
+    [[nodiscard]] unsigned int       arity()        const { return arity_;         }
+    [[nodiscard]] unsigned int       upvalueCount() const { return upvalue_count_; }
+    void setUpvalueCount(unsigned int count) { upvalue_count_ = count; }
+private:
+    Chunk        chunk_;
+    std::string  name_;
+    unsigned int arity_;
+    unsigned int upvalue_count_;
+};
+
+// variable captured by a closure: points into the vm stack while open, owns the value once closed
+class Upvalue final : public Object
+{
+public:
+    explicit Upvalue(Value* slot);
+    void trace(Heap& heap) override;
+
+    void close();
+
+    Value*   location;
+    Value    closed;
+    Upvalue* next;
+};
+
+class Closure final : public Callable
+{
+public:
+    explicit Closure(Prototype* prototype);
+    void trace(Heap& heap) override;
+
+    [[nodiscard]] unsigned int arity() const override;
+    Value call(Interpreter& interpreter, Args args) override;
+    [[nodiscard]] std::string toString() const override;
+    [[nodiscard]] Callable* bind(Heap& heap, Instance* instance) override;
+
+    [[nodiscard]] Prototype*             prototype() const { return prototype_; }
+    [[nodiscard]] std::vector<Upvalue*>& upvalues()        { return upvalues_;  }
+private:
+    Prototype*            prototype_;
+    std::vector<Upvalue*> upvalues_;
+};
+
+class BoundMethod final : public Callable
+{
+public:
+    BoundMethod(Instance* receiver, Closure* method);
+    void trace(Heap& heap) override;
+
+    [[nodiscard]] unsigned int arity() const override;
+    Value call(Interpreter& interpreter, Args args) override;
+    [[nodiscard]] std::string toString() const override;
+
+    [[nodiscard]] Instance* receiver() const { return receiver_; }
+    [[nodiscard]] Closure*  method()   const { return method_;   }
+private:
+    Instance* receiver_;
+    Closure*  method_;
+};
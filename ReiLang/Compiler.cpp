@@ -0,0 +1,630 @@
+#include "Compiler.hpp"
+#include <limits>
+
+Compiler::Compiler(Heap& heap, Logger& logger):
+    heap_(heap),
+    logger_(logger),
+    current_(nullptr),
+    line_(0)
+{
+}
+
+Prototype* Compiler::compile(const std::vector<Stmt::Base::Ptr>& statements)
+{
+    if (logger_.count(LogLevel::Fatal) > 0) {
+        logger_.log(LogLevel::Info, "Compiling terminated due to fatal errors.");
+        return nullptr;
+    }
+    FunctionState script{ nullptr, heap_.allocate<Prototype>("script", 0), {}, {}, {}, 0 };
+    script.locals.push_back({ "", 0, false });
+    current_ = &script;
+    try {
+        for (auto& s : statements) {
+            compile_(s);
+        }
+        emit_(OpCode::Nil);
+        emit_(OpCode::Return);
+    } catch (const CompileError& ce) {
+        logger_.log(LogLevel::Error, ce.line(), ce.what());
+    }
+    current_ = nullptr;
+    if (logger_.count(LogLevel::Error) > 0) {
+        logger_.log(LogLevel::Fatal, "Bad compiling.");
+        return nullptr;
+    }
+    logger_.elapse("Compiling");
+    return script.prototype;
+}
+
+Completion Compiler::visitExpression(Stmt::Expression& stmt)
+{
+    compile_(stmt.expr());
+    emit_(OpCode::Pop);
+    return {};
+}
+
+Completion Compiler::visitPrint(Stmt::Print& stmt)
+{
+    compile_(stmt.expr());
+    emit_(OpCode::Print);
+    return {};
+}
+
+Completion Compiler::visitVar(Stmt::Var& stmt)
+{
+    line_ = stmt.var().line;
+    const auto& name = stmt.var().lexeme;
+    declare_(name, line_);
+    if (stmt.expr()) {
+        compile_(stmt.expr());
+    } else {
+        emit_(OpCode::Nil);
+    }
+    define_(name);
+    return {};
+}
+
+Completion Compiler::visitBlock(Stmt::Block& stmt)
+{
+    begin_scope_();
+    compile_(stmt.statements());
+    end_scope_();
+    return {};
+}
+
+Completion Compiler::visitIfStmt(Stmt::IfStmt& stmt)
+{
+    compile_(stmt.condition());
+    const size_t then_jump = emit_jump_(OpCode::JumpIfFalse);
+    emit_(OpCode::Pop);
+    compile_(stmt.thenBranch());
+    const size_t else_jump = emit_jump_(OpCode::Jump);
+    patch_jump_(then_jump);
+    emit_(OpCode::Pop);
+    if (stmt.elseBranch()) {
+        compile_(stmt.elseBranch());
+    }
+    patch_jump_(else_jump);
+    return {};
+}
+
+Completion Compiler::visitWhile(Stmt::While& stmt)
+{
+    const size_t start = chunk_().size();
+    current_->loops.push_back({ current_->locals.size(), start, {}, {} });
+    compile_(stmt.condition());
+    const size_t exit_jump = emit_jump_(OpCode::JumpIfFalse);
+    emit_(OpCode::Pop);
+    compile_(stmt.body());
+    emit_loop_(start);
+    patch_jump_(exit_jump);
+    emit_(OpCode::Pop);
+    for (const size_t b : current_->loops.back().breaks) {
+        patch_jump_(b);
+    }
+    current_->loops.pop_back();
+    return {};
+}
+
+Completion Compiler::visitControl(Stmt::LoopControl& stmt)
+{
+    line_ = stmt.controller().line;
+    if (current_->loops.empty()) {
+        throw CompileError{ line_, "Loop controller outside loop." };
+    }
+    auto& loop = current_->loops.back();
+    discard_locals_(loop.locals);
+    if (stmt.controller().type == TokenType::Break) {
+        loop.breaks.push_back(emit_jump_(OpCode::Jump));
+    } else if (loop.continueTarget != std::numeric_limits<size_t>::max()) {
+        emit_loop_(loop.continueTarget);
+    } else {
+        loop.continues.push_back(emit_jump_(OpCode::Jump));
+    }
+    return {};
+}
+
+Completion Compiler::visitForLoop(Stmt::ForLoop& stmt)
+{
+    if (stmt.initializer()) {
+        compile_(stmt.initializer());
+    }
+    const size_t start = chunk_().size();
+    current_->loops.push_back({ current_->locals.size(), std::numeric_limits<size_t>::max(), {}, {} });
+    compile_(stmt.condition());
+    const size_t exit_jump = emit_jump_(OpCode::JumpIfFalse);
+    emit_(OpCode::Pop);
+    compile_(stmt.body());
+    for (const size_t c : current_->loops.back().continues) {
+        patch_jump_(c);
+    }
+    if (stmt.increment()) {
+        compile_(stmt.increment());
+    }
+    emit_loop_(start);
+    patch_jump_(exit_jump);
+    emit_(OpCode::Pop);
+    for (const size_t b : current_->loops.back().breaks) {
+        patch_jump_(b);
+    }
+    current_->loops.pop_back();
+    return {};
+}
+
+Completion Compiler::visitFunction(Stmt::Function* stmt)
+{
+    line_ = stmt->name().line;
+    const auto& name = stmt->name().lexeme;
+    declare_(name, line_);
+    // a local function is visible in its own body
+    if (current_->depth > 0) {
+        current_->locals.back().depth = current_->depth;
+    }
+    function_(name, stmt->params(), stmt->body(), false, line_);
+    define_(name);
+    return {};
+}
+
+Completion Compiler::visitReturn(Stmt::Return& stmt)
+{
+    line_ = stmt.keyword().line;
+    if (stmt.value()) {
+        compile_(stmt.value());
+    } else {
+        emit_(OpCode::Nil);
+    }
+    emit_(OpCode::Return);
+    return {};
+}
+
+Completion Compiler::visitKlass(Stmt::Klass& stmt)
+{
+	line_ = stmt.name().line;
+	const auto& name = stmt.name().lexeme;
+	declare_(name, line_);
+	emit_short_(OpCode::Class, name_(name));
+	define_(name);
+	get_var_(name, line_);
+	for (auto& m : stmt.methods()) {
+		function_(m->name().lexeme, m->params(), m->body(), true, m->name().line);
+		emit_short_(OpCode::Method, name_(m->name().lexeme));
+	}
+	emit_(OpCode::Pop);
+	return {};
+}
+
+Value Compiler::visitCall(Expr::Call& expr)
+{
+    // a method call leaves the receiver in the callee slot instead of a bound method
+    Expr::Get* method = nullptr;
+    if (expr.callee()->type() == AstNodeType::Get) {
+        method = static_cast<Expr::Get*>(expr.callee());
+        compile_(method->object());
+    } else {
+        compile_(expr.callee());
+    }
+    for (auto& a : expr.argument()) {
+        compile_(a);
+    }
+    line_ = expr.paren().line;
+    if (expr.argument().size() > std::numeric_limits<std::uint8_t>::max()) {
+        throw CompileError{ line_, "Too many arguments." };
+    }
+    const auto argc = static_cast<std::uint8_t>(expr.argument().size());
+    if (method) {
+        emit_short_(OpCode::Invoke, name_(method->name().lexeme));
+        chunk_().writeShort(cache_(), line_);
+        chunk_().write(argc, line_);
+    } else {
+        emit_(OpCode::Call, argc);
+    }
+    return {};
+}
+
+Value Compiler::visitAssign(Expr::Assign& expr)
+{
+    compile_(expr.value());
+    set_var_(expr.name().lexeme, expr.name().line);
+    return {};
+}
+
+Value Compiler::visitGrouping(Expr::Grouping& expr)
+{
+    compile_(expr.expression());
+    return {};
+}
+
+Value Compiler::visitTernary(Expr::Ternary& expr)
+{
+    compile_(expr.condition());
+    const size_t false_jump = emit_jump_(OpCode::JumpIfFalse);
+    emit_(OpCode::Pop);
+    compile_(expr.ifTrue());
+    const size_t end_jump = emit_jump_(OpCode::Jump);
+    patch_jump_(false_jump);
+    emit_(OpCode::Pop);
+    compile_(expr.ifFalse());
+    patch_jump_(end_jump);
+    return {};
+}
+
+// the left spine of a + b + c ... with a loop, so that a generated chain of any length costs no C++ stack
+Value Compiler::visitBinary(Expr::Binary& expr)
+{
+    std::vector<Expr::Binary*> chain;
+    Expr::Base::Ptr left = &expr;
+    while (left->type() == AstNodeType::Binary) {
+        chain.push_back(static_cast<Expr::Binary*>(left));
+        left = chain.back()->left();
+    }
+    compile_(left);
+    for (auto node = chain.rbegin(); node != chain.rend(); ++node) {
+        binary_(**node);
+    }
+    return {};
+}
+
+void Compiler::binary_(const Expr::Binary& expr)
+{
+    line_ = expr.oper().line;
+    // logical operators short-circuit and always produce a boolean
+    if (expr.oper().type == TokenType::And || expr.oper().type == TokenType::Or) {
+        size_t end_jump;
+        if (expr.oper().type == TokenType::And) {
+            end_jump = emit_jump_(OpCode::JumpIfFalse);
+        } else {
+            const size_t else_jump = emit_jump_(OpCode::JumpIfFalse);
+            end_jump = emit_jump_(OpCode::Jump);
+            patch_jump_(else_jump);
+        }
+        emit_(OpCode::Pop);
+        compile_(expr.right());
+        patch_jump_(end_jump);
+        emit_(OpCode::Not);
+        emit_(OpCode::Not);
+        return;
+    }
+    compile_(expr.right());
+    line_ = expr.oper().line;
+    switch (expr.oper().type) {
+    case TokenType::Plus:         emit_(OpCode::Add);          break;
+    case TokenType::Minus:        emit_(OpCode::Subtract);     break;
+    case TokenType::Star:         emit_(OpCode::Multiply);     break;
+    case TokenType::Slash:        emit_(OpCode::Divide);       break;
+    case TokenType::EqualEqual:   emit_(OpCode::Equal);        break;
+    case TokenType::BangEqual:    emit_(OpCode::NotEqual);     break;
+    case TokenType::Less:         emit_(OpCode::Less);         break;
+    case TokenType::LessEqual:    emit_(OpCode::LessEqual);    break;
+    case TokenType::Greater:      emit_(OpCode::Greater);      break;
+    case TokenType::GreaterEqual: emit_(OpCode::GreaterEqual); break;
+    default:
+        throw CompileError{ line_, "Unknown binary operator '" + std::string{ expr.oper().lexeme } + "'." };
+    }
+}
+
+Value Compiler::visitUnary(Expr::Unary& expr)
+{
+    compile_(expr.operand());
+    line_ = expr.oper().line;
+    if (expr.oper().type == TokenType::Minus) {
+        emit_(OpCode::Negate);
+    } else {
+        emit_(OpCode::Not);
+    }
+    return {};
+}
+
+Value Compiler::visitLiteral(Expr::Literal& expr)
+{
+    const Value value = expr.value();
+    switch (value.getType()) {
+    case ValueType::Nil:
+        emit_(OpCode::Nil);
+        break;
+    case ValueType::Bool:
+        emit_(value.getBool() ? OpCode::True : OpCode::False);
+        break;
+    default:
+        emit_constant_(value);
+    }
+    return {};
+}
+
+Value Compiler::visitVariable(Expr::Variable& expr)
+{
+    get_var_(expr.name().lexeme, expr.name().line);
+    return {};
+}
+
+Value Compiler::visitLambda(Expr::Lambda* expr)
+{
+    function_("Lambda", expr->params(), expr->body(), false, line_);
+    return {};
+}
+
+Value Compiler::visitGet(Expr::Get& expr)
+{
+	compile_(expr.object());
+	line_ = expr.name().line;
+	emit_short_(OpCode::GetProperty, name_(expr.name().lexeme));
+	chunk_().writeShort(cache_(), line_);
+	return {};
+}
+
+Value Compiler::visitSet(Expr::Set& expr)
+{
+	compile_(expr.object());
+	compile_(expr.value());
+	line_ = expr.name().line;
+	emit_short_(OpCode::SetProperty, name_(expr.name().lexeme));
+	chunk_().writeShort(cache_(), line_);
+	return {};
+}
+
+Value Compiler::visitThis(Expr::ThisKw& expr)
+{
+	get_var_("this", expr.keyword().line);
+	return {};
+}
+
+Compiler::CompileError::CompileError(const unsigned line, std::string msg):
+    msg_(std::move(msg)),
+    line_(line)
+{
+}
+
+char const* Compiler::CompileError::what() const
+{
+    return msg_.c_str();
+}
+
+unsigned Compiler::CompileError::line() const
+{
+    return line_;
+}
+
+void Compiler::compile_(Stmt::Base::Ptr statement)
+{
+    (void)statement->accept(*this);
+}
+
+void Compiler::compile_(const std::vector<Stmt::Base::Ptr>& statements)
+{
+    for (auto& s : statements) {
+        compile_(s);
+    }
+}
+
+void Compiler::compile_(Expr::Base::Ptr expression)
+{
+    (void)expression->accept(*this);
+}
+
+void Compiler::function_(const std::string_view name, const std::vector<Token>& params, const std::vector<Stmt::Base::Ptr>& body,
+                         const bool method, const unsigned line)
+{
+    if (params.size() > std::numeric_limits<std::uint8_t>::max()) {
+        throw CompileError{ line, "Too many parameters." };
+    }
+    FunctionState state{ current_, heap_.allocate<Prototype>(std::string{ name }, static_cast<unsigned>(params.size())), {}, {}, {}, 1 };
+    state.locals.push_back({ method ? "this" : "", 0, false });
+    current_ = &state;
+    for (auto& p : params) {
+        declare_(p.lexeme, p.line);
+        define_(p.lexeme);
+    }
+    compile_(body);
+    emit_(OpCode::Nil);
+    emit_(OpCode::Return);
+    state.prototype->setUpvalueCount(static_cast<unsigned>(state.upvalues.size()));
+    current_ = state.enclosing;
+
+    line_ = line;
+    emit_short_(OpCode::Closure, constant_(Value{ static_cast<Object*>(state.prototype) }));
+    for (auto& upvalue : state.upvalues) {
+        chunk_().write(static_cast<std::uint8_t>(upvalue.isLocal ? 1 : 0), line_);
+        chunk_().write(upvalue.index, line_);
+    }
+}
+
+void Compiler::emit_(const OpCode op)
+{
+    chunk_().write(op, line_);
+}
+
+void Compiler::emit_(const OpCode op, const std::uint8_t operand)
+{
+    chunk_().write(op, line_);
+    chunk_().write(operand, line_);
+}
+
+void Compiler::emit_short_(const OpCode op, const std::uint16_t operand)
+{
+    chunk_().write(op, line_);
+    chunk_().writeShort(operand, line_);
+}
+
+size_t Compiler::emit_jump_(const OpCode op)
+{
+    emit_short_(op, 0xffff);
+    return chunk_().size() - 2;
+}
+
+void Compiler::patch_jump_(const size_t offset)
+{
+    const size_t jump = chunk_().size() - offset - 2;
+    if (jump > std::numeric_limits<std::uint16_t>::max()) {
+        throw CompileError{ line_, "Too much code to jump over." };
+    }
+    chunk_().patchShort(offset, static_cast<std::uint16_t>(jump));
+}
+
+void Compiler::emit_loop_(const size_t start)
+{
+    const size_t offset = chunk_().size() - start + 3;
+    if (offset > std::numeric_limits<std::uint16_t>::max()) {
+        throw CompileError{ line_, "Loop body too large." };
+    }
+    emit_short_(OpCode::Loop, static_cast<std::uint16_t>(offset));
+}
+
+void Compiler::emit_constant_(const Value& value)
+{
+    emit_short_(OpCode::Constant, constant_(value));
+}
+
+std::uint16_t Compiler::constant_(const Value& value)
+{
+    const size_t index = chunk_().addConstant(value);
+    if (index > std::numeric_limits<std::uint16_t>::max()) {
+        throw CompileError{ line_, "Too many constants in one function." };
+    }
+    return static_cast<std::uint16_t>(index);
+}
+
+std::uint16_t Compiler::cache_()
+{
+    const size_t index = chunk_().addCache();
+    if (index > std::numeric_limits<std::uint16_t>::max()) {
+        throw CompileError{ line_, "Too many property accesses in one function." };
+    }
+    return static_cast<std::uint16_t>(index);
+}
+
+std::uint16_t Compiler::name_(const std::string_view name)
+{
+    return constant_(Value{ std::string{ name } });
+}
+
+std::uint16_t Compiler::global_(const std::string_view name)
+{
+    const auto found = global_slots_.find(name);
+    if (found != global_slots_.end()) {
+        return static_cast<std::uint16_t>(found->second);
+    }
+    if (global_names_.size() > std::numeric_limits<std::uint16_t>::max()) {
+        throw CompileError{ line_, "Too many global variables." };
+    }
+    global_slots_.emplace(name, static_cast<unsigned>(global_names_.size()));
+    global_names_.emplace_back(name);
+    return static_cast<std::uint16_t>(global_names_.size() - 1);
+}
+
+void Compiler::begin_scope_()
+{
+    current_->depth++;
+}
+
+void Compiler::end_scope_()
+{
+    current_->depth--;
+    auto& locals = current_->locals;
+    while (!locals.empty() && locals.back().depth > current_->depth) {
+        emit_(locals.back().captured ? OpCode::CloseUpvalue : OpCode::Pop);
+        locals.pop_back();
+    }
+}
+
+void Compiler::discard_locals_(const size_t keep)
+{
+    const auto& locals = current_->locals;
+    for (size_t i = locals.size(); i > keep; i--) {
+        emit_(locals[i - 1].captured ? OpCode::CloseUpvalue : OpCode::Pop);
+    }
+}
+
+void Compiler::declare_(const std::string_view name, const unsigned line)
+{
+    if (current_->depth == 0) {
+        return;
+    }
+    if (current_->locals.size() > std::numeric_limits<std::uint8_t>::max()) {
+        throw CompileError{ line, "Too many local variables in function." };
+    }
+    current_->locals.push_back({ name, -1, false });
+}
+
+void Compiler::define_(const std::string_view name)
+{
+    if (current_->depth == 0) {
+        emit_short_(OpCode::DefineGlobal, global_(name));
+        return;
+    }
+    current_->locals.back().depth = current_->depth;
+}
+
+Compiler::VarRef Compiler::resolve_(const std::string_view name, const unsigned line)
+{
+    const int local = resolve_local_(*current_, name);
+    if (local >= 0) {
+        return { VarKind::Local, static_cast<unsigned>(local) };
+    }
+    const int upvalue = resolve_upvalue_(*current_, name, line);
+    if (upvalue >= 0) {
+        return { VarKind::Upvalue, static_cast<unsigned>(upvalue) };
+    }
+    return { VarKind::Global, global_(name) };
+}
+
+int Compiler::resolve_local_(const FunctionState& state, const std::string_view name) const
+{
+    for (int i = static_cast<int>(state.locals.size()) - 1; i >= 0; i--) {
+        if (state.locals[i].name == name && state.locals[i].depth >= 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Compiler::resolve_upvalue_(FunctionState& state, const std::string_view name, const unsigned line)
+{
+    if (!state.enclosing) {
+        return -1;
+    }
+    const int local = resolve_local_(*state.enclosing, name);
+    if (local >= 0) {
+        state.enclosing->locals[local].captured = true;
+        return add_upvalue_(state, static_cast<std::uint8_t>(local), true, line);
+    }
+    const int upvalue = resolve_upvalue_(*state.enclosing, name, line);
+    if (upvalue >= 0) {
+        return add_upvalue_(state, static_cast<std::uint8_t>(upvalue), false, line);
+    }
+    return -1;
+}
+
+int Compiler::add_upvalue_(FunctionState& state, const std::uint8_t index, const bool isLocal, const unsigned line)
+{
+    for (size_t i = 0; i < state.upvalues.size(); i++) {
+        if (state.upvalues[i].index == index && state.upvalues[i].isLocal == isLocal) {
+            return static_cast<int>(i);
+        }
+    }
+    if (state.upvalues.size() > std::numeric_limits<std::uint8_t>::max()) {
+        throw CompileError{ line, "Too many closure variables in function." };
+    }
+    state.upvalues.push_back({ index, isLocal });
+    return static_cast<int>(state.upvalues.size() - 1);
+}
+
+void Compiler::get_var_(const std::string_view name, const unsigned line)
+{
+    line_ = line;
+    const auto ref = resolve_(name, line);
+    switch (ref.kind) {
+    case VarKind::Local:   emit_(OpCode::GetLocal, static_cast<std::uint8_t>(ref.index));         break;
+    case VarKind::Upvalue: emit_(OpCode::GetUpvalue, static_cast<std::uint8_t>(ref.index));       break;
+    case VarKind::Global:  emit_short_(OpCode::GetGlobal, static_cast<std::uint16_t>(ref.index)); break;
+    }
+}
+
+void Compiler::set_var_(const std::string_view name, const unsigned line)
+{
+    line_ = line;
+    const auto ref = resolve_(name, line);
+    switch (ref.kind) {
+    case VarKind::Local:   emit_(OpCode::SetLocal, static_cast<std::uint8_t>(ref.index));         break;
+    case VarKind::Upvalue: emit_(OpCode::SetUpvalue, static_cast<std::uint8_t>(ref.index));       break;
+    case VarKind::Global:  emit_short_(OpCode::SetGlobal, static_cast<std::uint16_t>(ref.index)); break;
+    }
+}
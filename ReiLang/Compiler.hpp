@@ -0,0 +1,145 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Ast.hpp"
+#include "Closure.hpp"
+#include "Heap.hpp"
+#include "Logger.hpp"
+#include "StringHash.hpp"
+
+//
+// Single pass from the resolved ast to bytecode.
+// Locals live in the vm stack window of their function (slot 0 holds the callee or 'this'),
+// captured ones are reached through upvalues, globals are numbered in order of first mention.
+//
+class Compiler final : Expr::Visitor, Stmt::Visitor
+{
+public:
+    Compiler(Heap& heap, Logger& logger);
+
+    // returns the top-level script function or nullptr on errors
+    [[nodiscard]] Prototype* compile(const std::vector<Stmt::Base::Ptr>& statements);
+    [[nodiscard]] const std::vector<std::string>& globals() const { return global_names_; }
+
+    Completion visitExpression(Stmt::Expression&) override;
+    Completion visitPrint(Stmt::Print&)           override;
+    Completion visitVar(Stmt::Var&)               override;
+    Completion visitBlock(Stmt::Block&)           override;
+    Completion visitIfStmt(Stmt::IfStmt&)         override;
+    Completion visitWhile(Stmt::While&)           override;
+    Completion visitControl(Stmt::LoopControl&)   override;
+    Completion visitForLoop(Stmt::ForLoop&)       override;
+    Completion visitFunction(Stmt::Function*)     override;
+    Completion visitReturn(Stmt::Return&)         override;
+    Completion visitKlass(Stmt::Klass&)           override;
+
+    Value visitCall(Expr::Call&)         override;
+    Value visitAssign(Expr::Assign&)     override;
+    Value visitGrouping(Expr::Grouping&) override;
+    Value visitTernary(Expr::Ternary&)   override;
+    Value visitBinary(Expr::Binary&)     override;
+    Value visitUnary(Expr::Unary&)       override;
+    Value visitLiteral(Expr::Literal&)   override;
+    Value visitVariable(Expr::Variable&) override;
+    Value visitLambda(Expr::Lambda*)     override;
+	Value visitGet(Expr::Get&)           override;
+	Value visitSet(Expr::Set&)           override;
+	Value visitThis(Expr::ThisKw&)       override;
+private:
+
+    class CompileError final : std::exception
+    {
+    public:
+        CompileError(unsigned int line, std::string msg);
+        [[nodiscard]] char const*  what() const override;
+        [[nodiscard]] unsigned int line() const;
+    private:
+        std::string msg_;
+        unsigned int line_;
+    };
+
+    struct Local
+    {
+        std::string_view name;
+        int              depth;
+        bool             captured;
+    };
+
+    struct UpvalueRef
+    {
+        std::uint8_t index;
+        bool         isLocal;
+    };
+
+    struct Loop
+    {
+        size_t              locals;         // locals alive outside of the loop
+        size_t              continueTarget; // npos while the target is not emitted yet
+        std::vector<size_t> continues;
+        std::vector<size_t> breaks;
+    };
+
+    struct FunctionState
+    {
+        FunctionState*          enclosing;
+        Prototype*              prototype;
+        std::vector<Local>      locals;
+        std::vector<UpvalueRef> upvalues;
+        std::vector<Loop>       loops;
+        int                     depth;
+    };
+
+    enum class VarKind
+    {
+        Local, Upvalue, Global
+    };
+
+    struct VarRef
+    {
+        VarKind  kind;
+        unsigned index;
+    };
+
+    void compile_(Stmt::Base::Ptr statement);
+    void compile_(const std::vector<Stmt::Base::Ptr>& statements);
+    void compile_(Expr::Base::Ptr expression);
+    // the operator of a binary whose left operand is already on the stack
+    void binary_(const Expr::Binary& expr);
+    void function_(std::string_view name, const std::vector<Token>& params, const std::vector<Stmt::Base::Ptr>& body,
+                   bool method, unsigned int line);
+
+    void emit_(OpCode op);
+    void emit_(OpCode op, std::uint8_t operand);
+    void emit_short_(OpCode op, std::uint16_t operand);
+    [[nodiscard]] size_t emit_jump_(OpCode op);
+    void patch_jump_(size_t offset);
+    void emit_loop_(size_t start);
+    void emit_constant_(const Value& value);
+    [[nodiscard]] std::uint16_t constant_(const Value& value);
+    [[nodiscard]] std::uint16_t name_(std::string_view name);
+    [[nodiscard]] std::uint16_t cache_();
+    [[nodiscard]] std::uint16_t global_(std::string_view name);
+
+    void begin_scope_();
+    void end_scope_();
+    void discard_locals_(size_t keep);
+    void declare_(std::string_view name, unsigned int line);
+    void define_(std::string_view name);
+    [[nodiscard]] VarRef resolve_(std::string_view name, unsigned int line);
+    [[nodiscard]] int resolve_local_(const FunctionState& state, std::string_view name) const;
+    [[nodiscard]] int resolve_upvalue_(FunctionState& state, std::string_view name, unsigned int line);
+    [[nodiscard]] int add_upvalue_(FunctionState& state, std::uint8_t index, bool isLocal, unsigned int line);
+    void get_var_(std::string_view name, unsigned int line);
+    void set_var_(std::string_view name, unsigned int line);
+
+    [[nodiscard]] Chunk& chunk_() const { return current_->prototype->chunk(); }
+
+    Heap&                                     heap_;
+    Logger&                                   logger_;
+    FunctionState*                            current_;
+    unsigned int                              line_;
+    StringMap<unsigned>                       global_slots_;
+    std::vector<std::string>                  global_names_;
+};
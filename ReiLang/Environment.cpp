@@ -1,13 +1,8 @@
 #include "Environment.hpp"
 
-#include "Logger.hpp"
-#include <iostream>
-
-Logger logger{ std::cout };
-
-EnvironmentException::EnvironmentException(const std::string& name)
+EnvironmentException::EnvironmentException(const std::string_view name)
 {
-    msg_ = "Undefined variable \'" + name + "\'.";
+    msg_ = "Undefined variable \'" + std::string{ name } + "\'.";
 }
 
 char const* EnvironmentException::what() const
@@ -16,65 +11,125 @@ char const* EnvironmentException::what() const
 }
 
 Environment::Environment():
+    Object(ObjectType::Environment),
     enclosing_(nullptr)
 {
 }
 
 Environment::Environment(Environment* enclosing):
+    Object(ObjectType::Environment),
     enclosing_(enclosing)
 {
 }
 
-void Environment::define(const std::string& name, const Value& value)
+void Environment::trace(Heap& heap)
+{
+    heap.mark(enclosing_);
+    for (auto& value : slots_) {
+        heap.mark(value);
+    }
+    for (auto& [_, value] : globals_) {
+        heap.mark(value);
+    }
+}
+
+void Environment::reuse(Environment* enclosing)
+{
+    slots_.clear();
+    enclosing_ = enclosing;
+}
+
+void Environment::define(const std::string_view name, const Value& value)
+{
+    const auto var = globals_.find(name);
+    if (var != globals_.end()) {
+        var->second = value;
+        return;
+    }
+	globals_.emplace(name, value);
+}
+
+void Environment::define(const unsigned slot, const Value& value)
 {
-    logger.log(LogLevel::Debug, "defining var " + name + " with val " + value.toString());
-	values_[name] = value;
+    if (slot == slots_.size()) {
+        slots_.push_back(value);
+        return;
+    }
+    if (slot > slots_.size()) {
+        slots_.resize(slot + 1);
+    }
+    slots_[slot] = value;
 }
 
-void Environment::assign(const std::string& name, const Value& value)
+void Environment::assign(const std::string_view name, const Value& value)
 {
-    logger.log(LogLevel::Debug, "Trying to assign var " + name + " with val " + value.toString());
-    if (values_.find(name) == values_.end()) {
-        if (enclosing_) {
-            enclosing_->assign(name, value);
-            return;
-        }
+    const auto var = globals_.find(name);
+    if (var == globals_.end()) {
         throw EnvironmentException{ name };
     }
-    logger.log(LogLevel::Debug, "Assigning var " + name + " with val " + value.toString());
-    values_[name] = value;
+    var->second = value;
 }
 
-void Environment::assignAt(const std::string& name, const Value& value, const unsigned distance)
+void Environment::assignAt(const unsigned distance, const unsigned slot, const Value& value)
 {
-    ancestor_(distance)->values_.at(name) = value;
+    auto& slots = ancestor_(distance)->slots_;
+    if (slot >= slots.size()) {
+        slots.resize(slot + 1);
+    }
+    slots[slot] = value;
 }
 
-Value Environment::lookup(const std::string& name) const
+Value Environment::lookup(const std::string_view name) const
 {
-    if (values_.find(name) == values_.end()) {
-        if (enclosing_) {
-            return enclosing_->lookup(name);
-        }
+    const auto var = globals_.find(name);
+    if (var == globals_.end()) {
         throw EnvironmentException{ name };
     }
-    return values_.at(name);
+    return var->second;
+}
+
+bool Environment::contains(const std::string_view name) const
+{
+    return globals_.find(name) != globals_.end();
 }
 
-Value Environment::lookupAt(const std::string& name, unsigned distance)
+Value* Environment::find(const std::string_view name)
 {
-    auto ancestor = ancestor_(distance);
-    if (ancestor->values_.find(name) != ancestor->values_.end()) {
-        return ancestor->values_.at(name);
+    const auto var = globals_.find(name);
+    return var != globals_.end() ? &var->second : nullptr;
+}
+
+Value Environment::lookupAt(const std::string_view name, const unsigned distance, const unsigned slot)
+{
+    const auto ancestor = ancestor_(distance);
+    if (slot < ancestor->slots_.size()) {
+        return ancestor->slots_[slot];
     }
     throw EnvironmentException{ name };
 }
 
 Environment* Environment::ancestor_(const unsigned distance)
 {
-    auto* ancestor = const_cast<Environment*>(this);
+    auto* ancestor = this;
     for (unsigned i = 0; i < distance; i++) {
         ancestor = ancestor->enclosing_;
     }
     return ancestor;
 }
+
+Environment* ScopeStack::push(Environment* enclosing)
+{
+    if (top_ == scopes_.size()) {
+        scopes_.emplace_back(enclosing);
+    } else {
+        scopes_[top_].reuse(enclosing);
+    }
+    return &scopes_[top_++];
+}
+
+void ScopeStack::trace(Heap& heap)
+{
+    for (size_t i = 0; i < top_; i++) {
+        scopes_[i].trace(heap);
+    }
+}
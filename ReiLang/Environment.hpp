@@ -1,31 +1,68 @@
 #pragma once
-#include <map>
+#include <deque>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "Value.hpp"
+#include "Heap.hpp"
+#include "StringHash.hpp"
 
 class EnvironmentException final : std::exception
 {
 public:
-    explicit EnvironmentException(const std::string& name);
+    explicit EnvironmentException(std::string_view name);
     [[nodiscard]] char const* what() const override;
 private:
     std::string msg_;
 };
 
-class Environment
+//
+// Local scopes keep their variables in slots assigned by the Resolver,
+// only the global scope is looked up by name.
+//
+class Environment final : public Object
 {
 public:
     Environment();
     explicit Environment(Environment* enclosing);
-    void define(const std::string& name, const Value& value);
-    void assign(const std::string& name, const Value& value);
-    void assignAt(const std::string& name, const Value& value, unsigned distance);
-    [[nodiscard]] Value lookup(const std::string& name) const;
-    [[nodiscard]] Value lookupAt(const std::string& name, unsigned distance);
+    void trace(Heap& heap) override;
+    // empties the slots for a new scope, keeping their storage
+    void reuse(Environment* enclosing);
+
+    void define(std::string_view name, const Value& value);
+    void define(unsigned slot, const Value& value);
+    void assign(std::string_view name, const Value& value);
+    void assignAt(unsigned distance, unsigned slot, const Value& value);
+    [[nodiscard]] Value lookup(std::string_view name) const;
+    [[nodiscard]] bool contains(std::string_view name) const;
+    // address of a global, stable for the life of the scope; nullptr when it is not defined
+    [[nodiscard]] Value* find(std::string_view name);
+    [[nodiscard]] Value lookupAt(std::string_view name, unsigned distance, unsigned slot);
 private:
     [[nodiscard]] Environment* ancestor_(unsigned int distance);
 
-    std::map<std::string, Value> values_;
-    Environment* enclosing_;
+    std::vector<Value> slots_;
+    StringMap<Value>   globals_;
+    Environment*       enclosing_;
 };
 
+//
+// Scopes of blocks and calls that the Resolver has found no closure can capture.
+// They are handed out and given back in LIFO order from storage that is never freed,
+// so a call costs no allocation once the stack has grown deep enough. The heap does not own them:
+// the owner traces the live ones as roots, and only captured scopes go to the heap.
+//
+class ScopeStack final
+{
+public:
+    ScopeStack() = default;
+    ScopeStack(const ScopeStack&)              = delete;
+    ScopeStack& operator = (const ScopeStack&) = delete;
+
+    [[nodiscard]] Environment* push(Environment* enclosing);
+    void pop() { --top_; }
+    void trace(Heap& heap);
+private:
+    std::deque<Environment> scopes_;
+    size_t                  top_ = 0;
+};
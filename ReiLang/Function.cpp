@@ -1,40 +1,52 @@
 #include "Function.hpp"
 #include <utility>
+#include "Instance.hpp"
 #include "Interpreter.hpp"
 
-Function::Function(Stmt::Function* declaration, std::shared_ptr<Environment> closure) :
-    params_(declaration->params()),
-    body_(declaration->body()),
+Function::Function(Stmt::Function* declaration, Environment* closure, const bool isMethod) :
+    Callable(ObjectType::Function),
+    params_(&declaration->params()),
+    body_(&declaration->body()),
     name_(declaration->name().lexeme),
-    closure_(std::move(closure)),
-	declaration_(declaration)
+    closure_(closure),
+    captured_(declaration->captured()),
+    receiver_(nullptr),
+    is_method_(isMethod)
 {
 }
 
-Function::Function(Expr::Lambda* declaration, std::shared_ptr<Environment> closure):
-    params_(declaration->params()),
-    body_(declaration->body()),
+Function::Function(Expr::Lambda* declaration, Environment* closure):
+    Callable(ObjectType::Function),
+    params_(&declaration->params()),
+    body_(&declaration->body()),
     name_("Lambda"),
-    closure_(std::move(closure)),
-	declaration_(nullptr)
+    closure_(closure),
+    captured_(declaration->captured()),
+    receiver_(nullptr),
+    is_method_(false)
+{
+}
+
+Function::Function(const Function& method, Instance* receiver):
+    Callable(ObjectType::Function),
+    params_(method.params_),
+    body_(method.body_),
+    name_(method.name_),
+    closure_(method.closure_),
+    captured_(method.captured_),
+    receiver_(receiver),
+    is_method_(true)
 {
 }
 
 unsigned Function::arity() const
 {
-    return params_.size();
+    return params_->size();
 }
 
-Value Function::call(Interpreter& interpreter, std::vector<Value> args)
+Value Function::call(Interpreter& interpreter, const Args args)
 {
-    auto environment = std::make_shared<Environment>( closure_.get() );
-    for (size_t i = 0; i < args.size(); i++) {
-        auto name = params_[i].lexeme;
-        auto val = args[i];
-        environment->define(name, val);
-    }
-    interpreter.execute_block_(body_, environment);
-    return Value{};
+    return execute_(interpreter, receiver_, args);
 }
 
 std::string Function::toString() const
@@ -42,9 +54,35 @@ std::string Function::toString() const
     return name_ + " :: t -> t1";
 }
 
-std::shared_ptr<Function> Function::bind(const std::weak_ptr<Instance>& instance) const
+Function* Function::bind(Heap& heap, Instance* instance)
 {
-	auto environment = std::make_shared<Environment>(*closure_);
-	environment->define("this", Value{ instance });
-	return std::make_shared<Function>(declaration_, environment);
+	return is_method_ ? heap.allocate<Function>(*this, instance) : this;
+}
+
+Value Function::invoke(Interpreter& interpreter, Instance* receiver, const Args args)
+{
+    return execute_(interpreter, receiver, args);
+}
+
+void Function::trace(Heap& heap)
+{
+	heap.mark(closure_);
+	heap.mark(receiver_);
+}
+
+Value Function::execute_(Interpreter& interpreter, Instance* receiver, const Args args)
+{
+    const Interpreter::ProfileFrame frame{ interpreter, name_ };
+    const Interpreter::NewScope scope{ interpreter, closure_, captured_ };
+    auto environment = scope.environment();
+    unsigned slot = 0;
+    if (is_method_) {
+        environment->define(slot++, Value{ receiver });
+    }
+    for (auto& a : args) {
+        REI_LOG(interpreter.logger_, LogLevel::Debug, "defining slot " + std::to_string(slot) + " with val " + a.toString());
+        environment->define(slot++, a);
+    }
+    const Completion completion = interpreter.execute_block_(*body_, environment);
+    return completion.type == Completion::Type::Return ? completion.value : Value{};
 }
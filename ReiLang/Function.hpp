@@ -4,20 +4,32 @@
 #include "Environment.hpp"
 #include "Ast.hpp"
 
+//
+// Function of the tree-walking interpreter. Keeps pointers into its declaration,
+// the ast outlives every function created from it.
+// Methods take the receiver in slot 0 of their scope, followed by the parameters.
+//
 class Function : public Callable
 {
 public:
-    explicit Function(Stmt::Function* declaration, std::shared_ptr<Environment> closure);
-    explicit Function(Expr::Lambda* declaration, std::shared_ptr<Environment> closure);
+    Function(Stmt::Function* declaration, Environment* closure, bool isMethod = false);
+    Function(Expr::Lambda* declaration, Environment* closure);
+    // method bound to the receiver
+    Function(const Function& method, Instance* receiver);
     [[nodiscard]] unsigned arity() const override;
-    Value call(Interpreter& interpreter, std::vector<Value> args) override;
+    Value call(Interpreter& interpreter, Args args) override;
     [[nodiscard]] std::string toString() const override;
-    [[nodiscard]] std::shared_ptr<Function> bind(const std::weak_ptr<Instance>& instance) const;
+    [[nodiscard]] Function* bind(Heap& heap, Instance* instance) override;
+    Value invoke(Interpreter& interpreter, Instance* receiver, Args args) override;
+    void trace(Heap& heap) override;
 private:
-    std::vector<Token> params_;
-    std::list<Stmt::Base::Ptr> body_;
-    std::string name_;
-    std::shared_ptr<Environment> closure_;
-	Stmt::Function* declaration_;
-};
+    Value execute_(Interpreter& interpreter, Instance* receiver, Args args);
 
+    const std::vector<Token>*         params_;
+    const std::vector<Stmt::Base::Ptr>* body_;
+    std::string                       name_;
+    Environment*                      closure_;
+    bool                              captured_;
+    Instance*                         receiver_;
+    bool                              is_method_;
+};
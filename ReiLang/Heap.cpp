@@ -0,0 +1,128 @@
+#include "Heap.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+thread_local Heap* current_heap = nullptr;
+
+}
+
+Heap::Heap(Logger& logger, const Config config):
+    logger_(logger),
+    config_(config),
+    objects_(nullptr),
+    bytes_allocated_(0),
+    peak_bytes_(0),
+    next_collection_(config.initialThreshold),
+    previous_(current_heap)
+{
+    current_heap = this;
+}
+
+Heap::~Heap()
+{
+    while (objects_) {
+        Object* next = objects_->next_;
+        delete objects_;
+        objects_ = next;
+    }
+    current_heap = previous_;
+}
+
+Heap& Heap::current()
+{
+    return *current_heap;
+}
+
+void Heap::pin(const Value& value)
+{
+    if (value.isObject()) {
+        pinned_.push_back(value.getObject());
+    }
+}
+
+void Heap::mark(const Value& value)
+{
+    if (value.isObject()) {
+        mark(value.getObject());
+    }
+}
+
+void Heap::mark(Object* object)
+{
+    if (object == nullptr || object->marked_) {
+        return;
+    }
+    object->marked_ = true;
+    gray_.push_back(object);
+}
+
+void Heap::collect(const std::function<void(Heap&)>& markRoots)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t before = bytes_allocated_;
+    const std::size_t freed = stats_.freed;
+
+    for (Object* object : pinned_) {
+        mark(object);
+    }
+    markRoots(*this);
+    trace_references_();
+    sweep_();
+    next_collection_ = std::max(static_cast<std::size_t>(bytes_allocated_ * config_.growthFactor), config_.initialThreshold);
+
+    const auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    stats_.collections++;
+    stats_.totalPause += pause;
+    stats_.maxPause = std::max(stats_.maxPause, pause);
+
+    REI_LOG(logger_, LogLevel::Debug, [&] {
+        std::ostringstream strout;
+        strout << "GC: freed " << stats_.freed - freed << " objects, " << before << " -> " << bytes_allocated_
+               << " bytes, next at " << next_collection_ << ", pause " << pause.count() / 1000 << " us.";
+        return strout.str();
+    }());
+}
+
+void Heap::register_(Object* object, const std::size_t size)
+{
+    object->size_ = size;
+    object->next_ = objects_;
+    objects_ = object;
+    bytes_allocated_ += size;
+    peak_bytes_ = std::max(peak_bytes_, bytes_allocated_);
+}
+
+std::size_t Heap::takePeak()
+{
+    const std::size_t peak = peak_bytes_;
+    peak_bytes_ = bytes_allocated_;
+    return peak;
+}
+
+void Heap::trace_references_()
+{
+    while (!gray_.empty()) {
+        Object* object = gray_.back();
+        gray_.pop_back();
+        object->trace(*this);
+    }
+}
+
+void Heap::sweep_()
+{
+    Object** link = &objects_;
+    while (*link) {
+        Object* object = *link;
+        if (object->marked_) {
+            object->marked_ = false;
+            link = &object->next_;
+        } else {
+            *link = object->next_;
+            bytes_allocated_ -= object->size_;
+            stats_.freed++;
+            delete object;
+        }
+    }
+}
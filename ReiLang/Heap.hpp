@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Object.hpp"
+#include "Value.hpp"
+#include "Logger.hpp"
+
+//
+// Mark-sweep garbage collected heap.
+// Allocation never collects by itself: the owner checks needsCollection() at its safe points
+// and calls collect() with a callback that marks everything it holds on to.
+//
+class Heap
+{
+public:
+    struct Config
+    {
+        std::size_t initialThreshold = 1024 * 1024;
+        double      growthFactor     = 2.0;
+    };
+
+    struct Stats
+    {
+        unsigned int             collections = 0;
+        std::size_t              freed       = 0;
+        std::chrono::nanoseconds totalPause  = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds maxPause    = std::chrono::nanoseconds::zero();
+    };
+
+    Heap(Logger& logger, Config config);
+
+    Heap(const Heap&)              = delete;
+    Heap(Heap&&)                   = delete;
+    Heap& operator = (const Heap&) = delete;
+    Heap& operator = (Heap&&)      = delete;
+    ~Heap();
+
+    // the most recently created heap of this thread
+    [[nodiscard]] static Heap& current();
+
+    template <typename T, typename... Args>
+    T* allocate(Args&&... args);
+
+    // keeps the object alive until the heap itself is destroyed
+    void pin(const Value& value);
+
+    void mark(const Value& value);
+    void mark(Object* object);
+
+    [[nodiscard]] bool needsCollection() const { return bytes_allocated_ > next_collection_; }
+    void collect(const std::function<void(Heap&)>& markRoots);
+
+    [[nodiscard]] const Stats& stats()          const { return stats_; }
+    [[nodiscard]] std::size_t  bytesAllocated() const { return bytes_allocated_; }
+    // most bytes held since the last call
+    [[nodiscard]] std::size_t  takePeak();
+private:
+    void register_(Object* object, std::size_t size);
+    void trace_references_();
+    void sweep_();
+
+    Logger&              logger_;
+    Config               config_;
+    Stats                stats_;
+    Object*              objects_;
+    std::vector<Object*> pinned_;
+    std::vector<Object*> gray_;
+    std::size_t          bytes_allocated_;
+    std::size_t          peak_bytes_;
+    std::size_t          next_collection_;
+    Heap*                previous_;
+};
+
+template <typename T, typename ... Args>
+T* Heap::allocate(Args&&... args)
+{
+    T* object = new T(std::forward<Args>(args)...);
+    register_(object, sizeof(T) + object->extent());
+    return object;
+}
@@ -1,9 +1,9 @@
 #include "Instance.hpp"
 #include "Interpreter.hpp"
 
-InstanceException::InstanceException(const std::string& name)
+InstanceException::InstanceException(const std::string_view name)
 {
-	msg_ = "Undefined property '" + name + "'.";
+	msg_ = "Undefined property '" + std::string{ name } + "'.";
 }
 
 char const* InstanceException::what() const
@@ -12,7 +12,9 @@ char const* InstanceException::what() const
 }
 
 Instance::Instance(Klass* klass):
-    klass_(klass)
+    Object(ObjectType::Instance),
+    klass_(klass),
+    shape_(klass->rootShape())
 {
 }
 
@@ -21,23 +23,57 @@ std::string Instance::toString() const
     return klass_->toString() + " instance";
 }
 
-Value Instance::get(const std::string& field) const
+Value Instance::get(Heap& heap, const std::string_view field, PropertyCache& cache)
 {
-	if (fields_.find(field) != fields_.end()) {
-		return fields_.at(field);
+	const Property property = lookup(field, cache);
+	return property.method ? Value{ property.method->bind(heap, this) } : property.value;
+}
+
+Instance::Property Instance::lookup(const std::string_view field, PropertyCache& cache)
+{
+	if (const auto hit = cache.find(shape_->id())) {
+		return hit->method ? Property{ Value{}, hit->method } : Property{ fields_[hit->slot] };
+	}
+	const unsigned slot = shape_->find(field);
+	if (slot != Shape::npos) {
+		cache.add({ shape_->id(), slot });
+		return { fields_[slot] };
 	}
 	const auto method = klass_->findMethod(field);
 	if (method) {
-		return Value{ method->bind( std::const_pointer_cast<Instance>(shared_from_this()) ) }; // really bad, I know
+		cache.add({ shape_->id(), Shape::npos, nullptr, method });
+		return { Value{}, method };
 	}
 	throw InstanceException{ field };
 }
 
-void Instance::put(const std::string& field, const Value& value)
+void Instance::put(const std::string_view field, const Value& value, PropertyCache& cache)
 {
-	if (fields_.find(field) != fields_.end()) {
-		fields_[field] = value;
+	if (const auto hit = cache.find(shape_->id())) {
+		if (hit->next) {
+			shape_ = hit->next;
+			fields_.push_back(value);
+		} else {
+			fields_[hit->slot] = value;
+		}
+		return;
+	}
+	const std::uint64_t id = shape_->id();
+	const unsigned slot = shape_->find(field);
+	if (slot != Shape::npos) {
+		cache.add({ id, slot });
+		fields_[slot] = value;
 	} else {
-		fields_.insert({ field, value });
+		shape_ = shape_->transition(field);
+		cache.add({ id, static_cast<unsigned>(fields_.size()), shape_ });
+		fields_.push_back(value);
+	}
+}
+
+void Instance::trace(Heap& heap)
+{
+	heap.mark(klass_);
+	for (auto& value : fields_) {
+		heap.mark(value);
 	}
 }
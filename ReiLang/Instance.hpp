@@ -1,25 +1,36 @@
 #pragma once
 #include "Klass.hpp"
-#include <map>
+#include <vector>
 
 class InstanceException : public std::exception
 {
 public:
-	explicit InstanceException(const std::string& name);
+	explicit InstanceException(std::string_view name);
 	[[nodiscard]] char const* what() const override;
 private:
 	std::string msg_;
 };
 
-class Instance : std::enable_shared_from_this<Instance>
+class Instance : public Object
 {
 public:
+	// a field value or a method that is not bound to the instance yet
+	struct Property
+	{
+		Value     value;
+		Callable* method = nullptr;
+	};
+
     explicit Instance(Klass* klass);
     [[nodiscard]] std::string toString() const;
-	[[nodiscard]] Value get(const std::string& field) const;
-	void put(const std::string& field, const Value& value);
+	// both look the shape up in the access site cache first
+	[[nodiscard]] Value get(Heap& heap, std::string_view field, PropertyCache& cache);
+	void put(std::string_view field, const Value& value, PropertyCache& cache);
+	[[nodiscard]] Property lookup(std::string_view field, PropertyCache& cache);
+	void trace(Heap& heap) override;
 private:
-    Klass* klass_;
-	std::map<std::string, Value> fields_;
+    Klass*             klass_;
+    Shape*             shape_;
+	std::vector<Value> fields_;
 };
 
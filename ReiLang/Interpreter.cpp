@@ -1,174 +1,235 @@
 #include "Interpreter.hpp"
 #include "StdLib/stdlib.hpp"
 #include "Instance.hpp"
+#include "Compiler.hpp"
+#include "Vm.hpp"
 #include <iostream>
+#include <random>
 #include <sstream>
 
-Interpreter::Interpreter(std::vector<Stmt::Base::Ptr> statements, Logger& logger):
+namespace {
+
+bool is_object(const Value& value, const ObjectType type)
+{
+    return value.isObject() && value.getObject()->objectType() == type;
+}
+
+}
+
+Interpreter::Interpreter(std::vector<Stmt::Base::Ptr> statements, Heap& heap, Logger& logger, const Output::Mode output):
     statements_(std::move(statements)),
+    heap_(heap),
     logger_(logger),
-    global_(std::make_shared<Environment>())
-{
-    global_->define("input", Value{ std::make_shared<InputFun>() });
-    global_->define("num"  , Value{ std::make_shared<NumFun>()   });
-    global_->define("rand" , Value{ std::make_shared<RandFun>()  });
+    global_(heap.allocate<Environment>()),
+    dispatch_(Dispatch::Switch),
+    vm_(nullptr),
+    random_(std::random_device{}()),
+    output_(std::cout, output),
+    profiler_(nullptr)
+{
+    global_->define("input", Value{ heap_.allocate<InputFun>() });
+    global_->define("num"  , Value{ heap_.allocate<NumFun>()   });
+    global_->define("rand" , Value{ heap_.allocate<RandFun>()  });
+    global_->define("randf", Value{ heap_.allocate<RandfFun>() });
+    global_->define("seed" , Value{ heap_.allocate<SeedFun>()  });
     environment_ = global_;
 }
 
-void Interpreter::interpret()
+void Interpreter::interpret(const Engine engine, const Dispatch dispatch)
 {
+    dispatch_ = dispatch;
     if (logger_.count(LogLevel::Fatal) > 0) {
         logger_.log(LogLevel::Info, "Interpreting terminated due to fatal errors.");
         return;
     }
+    // what the earlier phases logged comes before any output of the script
+    logger_.flush();
     try {
-        for (auto& s : statements_) {
-            execute_(*s);
+        if (engine == Engine::Bytecode) {
+            run_bytecode_();
+        } else {
+            walk_();
         }
     } catch (const RuntimeError& re) {
+        flush_();
         logger_.log(LogLevel::Error, re.line(), re.what());
     } catch (const std::exception& e) {
+        flush_();
         logger_.log(LogLevel::Error, e.what());
     }
+    flush_();
     if (logger_.count(LogLevel::Error) > 0) {
         logger_.log(LogLevel::Fatal, "Bad interpreting.");
     }
     logger_.elapse("Interpreting");
+    const auto& gc = heap_.stats();
+    if (gc.collections > 0) {
+        std::ostringstream strout;
+        strout << "Garbage collection: " << gc.collections << " cycles, " << gc.freed << " objects freed, total pause "
+               << gc.totalPause.count() / 1000 << " us, max pause " << gc.maxPause.count() / 1000 << " us.";
+        logger_.log(LogLevel::Info, strout.str());
+    }
 }
 
-void Interpreter::visitExpression(Stmt::Expression& stmt)
+Completion Interpreter::visitExpression(Stmt::Expression& stmt)
 {
     (void)evaluate_(*stmt.expr());
-    
+    return {};
 }
 
-void Interpreter::visitPrint(Stmt::Print& stmt)
+Completion Interpreter::visitPrint(Stmt::Print& stmt)
 {
-    const Value val = evaluate_(*stmt.expr());
-    std::cout << val.toString() << "\n";
+    output_.print(evaluate_(*stmt.expr()));
+    return {};
 }
 
-void Interpreter::visitVar(Stmt::Var& stmt)
+Completion Interpreter::visitVar(Stmt::Var& stmt)
 {
     Value val{};
     if (stmt.expr()) {
         val = evaluate_(*stmt.expr());
     }
-    environment_->define(stmt.var().lexeme, val);
+    define_var_(stmt.slot(), stmt.var().lexeme, val);
+    return {};
 }
 
-void Interpreter::visitBlock(Stmt::Block& stmt)
+Completion Interpreter::visitBlock(Stmt::Block& stmt)
 {
-    const auto local = std::make_shared<Environment>(environment_.get());
-    execute_block_(stmt.statements(), local);
+    const NewScope local{ *this, environment_, stmt.captured() };
+    return execute_block_(stmt.statements(), local.environment());
 }
 
-void Interpreter::visitIfStmt(Stmt::IfStmt& stmt)
+Completion Interpreter::visitIfStmt(Stmt::IfStmt& stmt)
 {
     if (evaluate_(*stmt.condition()).isTrue()) {
-        execute_(*stmt.thenBranch());
-    } else if (stmt.elseBranch()) {
-        execute_(*stmt.elseBranch());
+        return execute_(*stmt.thenBranch());
     }
+    if (stmt.elseBranch()) {
+        return execute_(*stmt.elseBranch());
+    }
+    return {};
 }
 
-void Interpreter::visitWhile(Stmt::While& stmt)
+Completion Interpreter::visitWhile(Stmt::While& stmt)
 {
     while (evaluate_(*stmt.condition()).isTrue()) {
-        try {
-            execute_(*stmt.body());
-        } catch (const ContinueCnt&) {
-            // continue execution
-        } catch (const BreakCnt&) {
-            return;
+        const Completion completion = execute_(*stmt.body());
+        if (completion.type == Completion::Type::Break) {
+            break;
+        }
+        if (completion.type == Completion::Type::Return) {
+            return completion;
         }
     }
+    return {};
 }
 
-void Interpreter::visitControl(Stmt::LoopControl& stmt)
+Completion Interpreter::visitControl(Stmt::LoopControl& stmt)
 {
     if (stmt.controller().type == TokenType::Break) {
-        throw BreakCnt{ stmt.controller() };
+        return { Completion::Type::Break };
     }
-    throw ContinueCnt{ stmt.controller() };
+    return { Completion::Type::Continue };
 }
 
-void Interpreter::visitForLoop(Stmt::ForLoop& stmt)
+Completion Interpreter::visitForLoop(Stmt::ForLoop& stmt)
 {
     if (stmt.initializer()) {
-        execute_(*stmt.initializer());
+        (void)execute_(*stmt.initializer());
     }
     while (evaluate_(*stmt.condition()).isTrue()) {
-        try {
-            execute_(*stmt.body());
-            if (stmt.increment()) {
-                execute_(*stmt.increment());
-            }
-        } catch (const ContinueCnt&) {
-            if (stmt.increment()) {
-                execute_(*stmt.increment());
-            }
-        } catch (const BreakCnt&) {
-            return;
+        const Completion completion = execute_(*stmt.body());
+        if (completion.type == Completion::Type::Break) {
+            break;
+        }
+        if (completion.type == Completion::Type::Return) {
+            return completion;
+        }
+        if (stmt.increment()) {
+            (void)execute_(*stmt.increment());
         }
     }
+    return {};
 }
 
-void Interpreter::visitFunction(Stmt::Function* stmt)
+Completion Interpreter::visitFunction(Stmt::Function* stmt)
 {
-    const std::shared_ptr<Callable> fun = std::make_shared<Function>(stmt, environment_);
-    environment_->define(stmt->name().lexeme, Value{ fun });
+    Callable* fun = heap_.allocate<Function>(stmt, environment_);
+    define_var_(stmt->slot(), stmt->name().lexeme, Value{ fun });
+    return {};
 }
 
-void Interpreter::visitReturn(Stmt::Return& stmt)
+Completion Interpreter::visitReturn(Stmt::Return& stmt)
 {
     Value val{};
     if (stmt.value()) {
         val = evaluate_(*stmt.value());
     }
-    throw ReturnCnt{ stmt.keyword(), val };
+    return { Completion::Type::Return, val };
 }
 
-void Interpreter::visitKlass(Stmt::Klass& stmt)
+Completion Interpreter::visitKlass(Stmt::Klass& stmt)
 {
-	std::map<std::string, std::shared_ptr<Function>> methods;
+	Klass::Methods methods;
 	for (auto& m : stmt.methods()) {
-		methods.insert({ m->name().lexeme, std::make_shared<Function>(m.get(), environment_) });
+		methods.emplace(m->name().lexeme, heap_.allocate<Function>(m, environment_, true));
 	}
-	environment_->define(stmt.name().lexeme, Value{ std::make_shared<Klass>(stmt.name().lexeme, methods) });
+	define_var_(stmt.slot(), stmt.name().lexeme, Value{ heap_.allocate<Klass>(std::string{ stmt.name().lexeme }, methods) });
+	return {};
 }
 
 Value Interpreter::visitCall(Expr::Call& expr)
 {
+    if (expr.callee()->type() == AstNodeType::Get) {
+        return invoke_(static_cast<Expr::Get&>(*expr.callee()), expr);
+    }
+    TempRoots roots{ *this };
     const Value callee = evaluate_(*expr.callee());
-    std::vector<Value> args;
+    roots.push(callee);
     for (auto& a : expr.argument()) {
-        args.push_back(evaluate_(*a));
+        roots.push(evaluate_(*a));
+    }
+    const Args args = roots.top(expr.argument().size());
+    if (expr.calleeIsFunction()) {
+        if (is_object(callee, ObjectType::Function)) {
+            auto* fun = static_cast<Function*>(callee.getObject());
+            if (args.size() == fun->Function::arity()) {
+                return fun->Function::call(*this, args);
+            }
+        }
+        expr.despecialize();
+    } else if (expr.calleeIsNative()) {
+        if (is_object(callee, ObjectType::Native)) {
+            const auto* native = static_cast<Native*>(callee.getObject());
+            if (args.size() == native->arity()) {
+                return native->enter(*this, args.begin());
+            }
+        }
+        expr.despecialize();
+    } else {
+        expr.observe(callee);
     }
     if (callee.getType() != ValueType::Callable) {
         throw RuntimeError{ expr.paren().line, "Can only call functions and classes." };
     }
     auto fun = callee.getCallable();
-    if (args.size() != fun->arity()) {
-        std::ostringstream strout;
-        strout << "Expected " << fun->arity() << " arguments but got " << args.size() << ".";
-        throw RuntimeError{ expr.paren().line, strout.str() };
-    }
-    try {
-        return fun->call(*this, args);
-    } catch (const ReturnCnt& rc) {
-        return rc.value();
-    }
+    check_arity_(*fun, args.size(), expr.paren());
+    return fun->call(*this, args);
 }
 
 Value Interpreter::visitAssign(Expr::Assign& expr)
 {
     try {
         const Value value = evaluate_(*expr.value());
-        if (locals_.find(&expr) == locals_.end()) {
+        const auto& slot = expr.slot();
+        REI_LOG(logger_, LogLevel::Debug, "Assigning var " + std::string{ expr.name().lexeme } + " with val " + value.toString());
+        if (expr.global()) {
+            *expr.global() = value;
+        } else if (slot.isGlobal()) {
             global_->assign(expr.name().lexeme, value);
+            expr.cache(global_->find(expr.name().lexeme));
         } else {
-            environment_->assignAt(expr.name().lexeme, value, locals_.at(&expr));
+            environment_->assignAt(slot.distance, slot.index, value);
         }
         return value;
     } catch (const EnvironmentException& ee) {
@@ -190,35 +251,128 @@ Value Interpreter::visitTernary(Expr::Ternary& expr)
     return evaluate_(*expr.ifFalse());
 }
 
+namespace {
+
+// false when the operands do not fit the specialization of the node
+bool quick_binary(const Expr::Binary::Quick quick, const Value& l, const Value& r, Value& result)
+{
+    using Quick = Expr::Binary::Quick;
+    if (quick == Quick::StringConcat) {
+        if (l.getType() != ValueType::String || r.getType() != ValueType::String) {
+            return false;
+        }
+        result = Value{ l.getString() + r.getString() };
+        return true;
+    }
+    if (!l.isNumber() || !r.isNumber()) {
+        return false;
+    }
+    const double a = l.getNumber();
+    const double b = r.getNumber();
+    switch (quick) {
+    case Quick::NumberAdd:          result = Value{ a + b };  return true;
+    case Quick::NumberSubtract:     result = Value{ a - b };  return true;
+    case Quick::NumberMultiply:     result = Value{ a * b };  return true;
+    case Quick::NumberDivide:
+        if (b == 0) {
+            return false;
+        }
+        result = Value{ a / b };
+        return true;
+    // the same IEEE comparisons Value's operators make, NaN included
+    case Quick::NumberLess:         result = Value{ a < b };  return true;
+    case Quick::NumberLessEqual:    result = Value{ a <= b }; return true;
+    case Quick::NumberGreater:      result = Value{ a > b };  return true;
+    case Quick::NumberGreaterEqual: result = Value{ a >= b }; return true;
+    case Quick::NumberEqual:        result = Value{ a == b }; return true;
+    case Quick::NumberNotEqual:     result = Value{ a != b }; return true;
+    default:                        return false;
+    }
+}
+
+}
+
 Value Interpreter::visitBinary(Expr::Binary& expr)
 {
+    if (expr.left()->type() == AstNodeType::Binary) {
+        return binary_chain_(expr);
+    }
+    TempRoots roots{ *this };
+    const Value l = evaluate_(*expr.left());
+    roots.push(l);
+    return apply_binary_(expr, l);
+}
+
+// the parser builds a + b + c ... left-deep, so the left spine is walked with a loop
+// and a generated chain of any length costs no C++ stack
+Value Interpreter::binary_chain_(Expr::Binary& expr)
+{
+    const size_t base = chain_.size();
+    Expr::Base* left = &expr;
+    while (left->type() == AstNodeType::Binary) {
+        chain_.push_back(static_cast<Expr::Binary*>(left));
+        left = static_cast<Expr::Binary*>(left)->left();
+    }
+    try {
+        TempRoots roots{ *this };
+        Value value = evaluate_(*left);
+        roots.push(value);
+        while (chain_.size() > base) {
+            Expr::Binary& node = *chain_.back();
+            chain_.pop_back();
+            value = apply_binary_(node, value);
+            roots.push(value);
+        }
+        return value;
+    } catch (...) {
+        chain_.resize(base);
+        throw;
+    }
+}
+
+Value Interpreter::apply_binary_(Expr::Binary& expr, const Value& l)
+{
+    if (expr.specialized()) {
+        const Value r = evaluate_(*expr.right());
+        Value result;
+        if (quick_binary(expr.quick(), l, r, result)) {
+            return result;
+        }
+        expr.despecialize();
+        return binary_(expr, l, r);
+    }
     try {
-        const Value l = evaluate_(*expr.left());
         switch (expr.oper().type) {
-        case TokenType::Plus:
-            return l + evaluate_(*expr.right());
-        case TokenType::Minus:
-            return l - evaluate_(*expr.right());
-        case TokenType::Star:
-            return l * evaluate_(*expr.right());
-        case TokenType::Slash:
-            return l / evaluate_(*expr.right());
-        case TokenType::EqualEqual:
-            return l == evaluate_(*expr.right());
-        case TokenType::BangEqual:
-            return l != evaluate_(*expr.right());
-        case TokenType::Less:
-            return l < evaluate_(*expr.right());
-        case TokenType::LessEqual:
-            return  l <= evaluate_(*expr.right());
-        case TokenType::Greater:
-            return  l > evaluate_(*expr.right());
-        case TokenType::GreaterEqual:
-            return l >= evaluate_(*expr.right());
         case TokenType::And:
             return l.isTrue() ? l && evaluate_(*expr.right()) : Value{ false };
         case TokenType::Or:
-            return l.isTrue() ? Value{ true } : l && evaluate_(*expr.right());
+            return l.isTrue() ? Value{ true } : l || evaluate_(*expr.right());
+        default:;
+        }
+    } catch (const ValueOperationException& voe) {
+        throw RuntimeError{ expr.oper().line, voe.what() };
+    }
+    const Value r = evaluate_(*expr.right());
+    if (expr.quick() == Expr::Binary::Quick::Uninitialized) {
+        expr.observe(l, r);
+    }
+    return binary_(expr, l, r);
+}
+
+Value Interpreter::binary_(const Expr::Binary& expr, const Value& l, const Value& r) const
+{
+    try {
+        switch (expr.oper().type) {
+        case TokenType::Plus:         return l + r;
+        case TokenType::Minus:        return l - r;
+        case TokenType::Star:         return l * r;
+        case TokenType::Slash:        return l / r;
+        case TokenType::EqualEqual:   return l == r;
+        case TokenType::BangEqual:    return l != r;
+        case TokenType::Less:         return l < r;
+        case TokenType::LessEqual:    return l <= r;
+        case TokenType::Greater:      return l > r;
+        case TokenType::GreaterEqual: return l >= r;
         default:;
         }
     } catch (const ValueOperationException& voe) {
@@ -253,8 +407,19 @@ Value Interpreter::visitLiteral(Expr::Literal& expr)
 
 Value Interpreter::visitVariable(Expr::Variable& expr)
 {
+    if (expr.global()) {
+        return *expr.global();
+    }
+    if (expr.slot().isGlobal()) {
+        Value* global = global_->find(expr.name().lexeme);
+        if (!global) {
+            throw RuntimeError{ expr.name().line, EnvironmentException{ expr.name().lexeme }.what() };
+        }
+        expr.cache(global);
+        return *global;
+    }
     try {
-        return lookup_var_(&expr, expr.name());
+        return lookup_var_(expr.slot(), expr.name());
     } catch (const EnvironmentException& ee) {
         throw RuntimeError{ expr.name().line, ee.what() };
     }
@@ -262,7 +427,7 @@ Value Interpreter::visitVariable(Expr::Variable& expr)
 
 Value Interpreter::visitLambda(Expr::Lambda* expr)
 {
-    const std::shared_ptr<Callable> fun = std::make_shared<Function>(expr, environment_);
+    Callable* fun = heap_.allocate<Function>(expr, environment_);
     return Value{ fun };
 }
 
@@ -271,7 +436,7 @@ Value Interpreter::visitGet(Expr::Get& expr)
 	auto obj = evaluate_(*expr.object());
 	if (obj.getType() == ValueType::Instance) {
 		try {
-			return obj.getInstance()->get(expr.name().lexeme);
+			return obj.getInstance()->get(heap_, expr.name().lexeme, expr.cache());
 		} catch (const InstanceException& ie) {
 			throw RuntimeError{ expr.name().line, ie.what() };
 		}
@@ -281,86 +446,200 @@ Value Interpreter::visitGet(Expr::Get& expr)
 
 Value Interpreter::visitSet(Expr::Set& expr)
 {
+	TempRoots roots{ *this };
 	auto obj = evaluate_(*expr.object());
 	if (obj.getType() != ValueType::Instance) {
 		throw RuntimeError{ expr.name().line, "Only instances have fields." };
 	}
+	roots.push(obj);
 	auto val = evaluate_(*expr.value());
-	obj.getInstance()->put(expr.name().lexeme, val);
+	obj.getInstance()->put(expr.name().lexeme, val, expr.cache());
 	return val;
 }
 
 Value Interpreter::visitThis(Expr::ThisKw& expr)
 {
-	return lookup_var_(&expr, expr.keyword());
+	return lookup_var_(expr.slot(), expr.keyword());
 }
 
-void Interpreter::resolve(Expr::Base* expr, const unsigned distance)
+Interpreter::RuntimeError::RuntimeError(const unsigned line, std::string msg):
+    msg_(std::move(msg)),
+    line_(line)
 {
-    locals_[expr] = distance;
 }
 
-Interpreter::ContinueCnt::ContinueCnt(Token controller):
-    controller_(std::move(controller))
+char const* Interpreter::RuntimeError::what() const
 {
+    return msg_.c_str();
 }
 
-Interpreter::BreakCnt::BreakCnt(Token controller):
-    controller_(std::move(controller))
+unsigned Interpreter::RuntimeError::line() const
 {
+    return line_;
 }
 
-Interpreter::ReturnCnt::ReturnCnt(Token keyword, Value value):
-    keyword_(std::move(keyword)),
-    value_(std::move(value))
+Value Interpreter::evaluate_(Expr::Base& expr)
 {
+    if (dispatch_ == Dispatch::Visitor) {
+        return expr.accept(*this);
+    }
+    switch (expr.type()) {
+    case AstNodeType::Call:     return visitCall(static_cast<Expr::Call&>(expr));
+    case AstNodeType::Assign:   return visitAssign(static_cast<Expr::Assign&>(expr));
+    case AstNodeType::Grouping: return visitGrouping(static_cast<Expr::Grouping&>(expr));
+    case AstNodeType::Ternary:  return visitTernary(static_cast<Expr::Ternary&>(expr));
+    case AstNodeType::Binary:   return visitBinary(static_cast<Expr::Binary&>(expr));
+    case AstNodeType::Unary:    return visitUnary(static_cast<Expr::Unary&>(expr));
+    case AstNodeType::Literal:  return visitLiteral(static_cast<Expr::Literal&>(expr));
+    case AstNodeType::Variable: return visitVariable(static_cast<Expr::Variable&>(expr));
+    case AstNodeType::Function: return visitLambda(static_cast<Expr::Lambda*>(&expr));
+    case AstNodeType::Get:      return visitGet(static_cast<Expr::Get&>(expr));
+    case AstNodeType::Set:      return visitSet(static_cast<Expr::Set&>(expr));
+    case AstNodeType::ThisKw:   return visitThis(static_cast<Expr::ThisKw&>(expr));
+    default:                    return expr.accept(*this);
+    }
 }
 
-Interpreter::RuntimeError::RuntimeError(const unsigned line, std::string msg):
-    msg_(std::move(msg)),
-    line_(line)
+Completion Interpreter::execute_(Stmt::Base& stmt)
 {
+    if (heap_.needsCollection()) {
+        collect_garbage_();
+    }
+    if (profiler_) {
+        profiler_->at(stmt.line());
+    }
+    if (dispatch_ == Dispatch::Visitor) {
+        return stmt.accept(*this);
+    }
+    switch (stmt.type()) {
+    case AstNodeType::Expression: return visitExpression(static_cast<Stmt::Expression&>(stmt));
+    case AstNodeType::Print:      return visitPrint(static_cast<Stmt::Print&>(stmt));
+    case AstNodeType::Var:        return visitVar(static_cast<Stmt::Var&>(stmt));
+    case AstNodeType::Block:      return visitBlock(static_cast<Stmt::Block&>(stmt));
+    case AstNodeType::IfStmt:     return visitIfStmt(static_cast<Stmt::IfStmt&>(stmt));
+    case AstNodeType::While:      return visitWhile(static_cast<Stmt::While&>(stmt));
+    case AstNodeType::Controller: return visitControl(static_cast<Stmt::LoopControl&>(stmt));
+    case AstNodeType::ForLoop:    return visitForLoop(static_cast<Stmt::ForLoop&>(stmt));
+    case AstNodeType::Function:   return visitFunction(static_cast<Stmt::Function*>(&stmt));
+    case AstNodeType::Return:     return visitReturn(static_cast<Stmt::Return&>(stmt));
+    case AstNodeType::Klass:      return visitKlass(static_cast<Stmt::Klass&>(stmt));
+    default:                      return stmt.accept(*this);
+    }
 }
 
-char const* Interpreter::RuntimeError::what() const
+Completion Interpreter::execute_block_(const std::vector<Stmt::Base::Ptr>& statements, Environment* local)
 {
-    return msg_.c_str();
+    EnterScope scope{ *this, local };
+    for (auto& s : statements) {
+        const Completion completion = execute_(*s);
+        if (!completion.isNormal()) {
+            return completion;
+        }
+    }
+    return {};
 }
 
-unsigned Interpreter::RuntimeError::line() const
+void Interpreter::walk_()
 {
-    return line_;
+    const ProfileFrame script{ *this, "script" };
+    for (auto& s : statements_) {
+        (void)execute_(*s);
+    }
 }
 
-Value Interpreter::evaluate_(Expr::Base& expr)
+void Interpreter::run_bytecode_()
 {
-    return expr.accept(*this);
+    Compiler compiler{ heap_, logger_ };
+    Prototype* script = compiler.compile(statements_);
+    if (!script) {
+        return;
+    }
+    Vm vm{ *this, heap_, compiler.globals() };
+    vm_ = &vm;
+    try {
+        vm.run(script);
+    } catch (...) {
+        vm_ = nullptr;
+        throw;
+    }
+    vm_ = nullptr;
 }
 
-void Interpreter::execute_(Stmt::Base& stmt)
+void Interpreter::flush_()
 {
-    stmt.accept(*this);
+    logger_.flush();
+    output_.flush();
 }
 
-void Interpreter::execute_block_(const std::list<Stmt::Base::Ptr>& statements, std::shared_ptr<Environment> local)
+void Interpreter::collect_garbage_()
 {
-    const auto prev = environment_;
-    try {
-        environment_ = local;
-        for (auto& s : statements) {
-            execute_(*s);
+    heap_.collect([this](Heap& heap) {
+        heap.mark(global_);
+        heap.mark(environment_);
+        for (auto* frame : frames_) {
+            heap.mark(frame);
         }
-        environment_ = prev;
-    } catch (...) {
-        environment_ = prev;
-        throw;
+        scopes_.trace(heap);
+        for (auto& value : temps_) {
+            heap.mark(value);
+        }
+    });
+}
+
+Value Interpreter::invoke_(Expr::Get& get, Expr::Call& expr)
+{
+    TempRoots roots{ *this };
+    const Value obj = evaluate_(*get.object());
+    if (obj.getType() != ValueType::Instance) {
+        throw RuntimeError{ get.name().line, "Only instances have properties." };
+    }
+    roots.push(obj);
+    Instance::Property property;
+    try {
+        property = obj.getInstance()->lookup(get.name().lexeme, get.cache());
+    } catch (const InstanceException& ie) {
+        throw RuntimeError{ get.name().line, ie.what() };
+    }
+    roots.push(property.value);
+    for (auto& a : expr.argument()) {
+        roots.push(evaluate_(*a));
+    }
+    const Args args = roots.top(expr.argument().size());
+    if (property.method) {
+        check_arity_(*property.method, args.size(), expr.paren());
+        return property.method->invoke(*this, obj.getInstance(), args);
     }
+    if (property.value.getType() != ValueType::Callable) {
+        throw RuntimeError{ expr.paren().line, "Can only call functions and classes." };
+    }
+    auto fun = property.value.getCallable();
+    check_arity_(*fun, args.size(), expr.paren());
+    return fun->call(*this, args);
 }
 
-Value Interpreter::lookup_var_(Expr::Base* expr, const Token& token)
+void Interpreter::check_arity_(const Callable& fun, const size_t argc, const Token& paren) const
 {
-    if (locals_.find(expr) == locals_.end()) {
+    if (argc != fun.arity()) {
+        std::ostringstream strout;
+        strout << "Expected " << fun.arity() << " arguments but got " << argc << ".";
+        throw RuntimeError{ paren.line, strout.str() };
+    }
+}
+
+Value Interpreter::lookup_var_(const VarSlot& slot, const Token& token)
+{
+    if (slot.isGlobal()) {
         return global_->lookup(token.lexeme);
     }
-    return environment_->lookupAt(token.lexeme, locals_.at(expr));
+    return environment_->lookupAt(token.lexeme, slot.distance, slot.index);
+}
+
+void Interpreter::define_var_(const VarSlot& slot, const std::string_view name, const Value& value)
+{
+    REI_LOG(logger_, LogLevel::Debug, "defining var " + std::string{ name } + " with val " + value.toString());
+    if (slot.isGlobal()) {
+        environment_->define(name, value);
+    } else {
+        environment_->define(slot.index, value);
+    }
 }
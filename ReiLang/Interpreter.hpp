@@ -3,25 +3,54 @@
 #include "Logger.hpp"
 #include "Environment.hpp"
 #include "Function.hpp"
+#include "Native.hpp"
+#include "Random.hpp"
+#include "Output.hpp"
+#include "Profiler.hpp"
+#include "Heap.hpp"
 #include <vector>
 
+class Vm;
+
 class Interpreter final : Expr::Visitor, Stmt::Visitor
 {
 public:
-    Interpreter(std::vector<Stmt::Base::Ptr> statements, Logger& logger);
-    void interpret();
-
-    void visitExpression(Stmt::Expression&) override;
-    void visitPrint(Stmt::Print&)           override;
-    void visitVar(Stmt::Var&)               override;
-    void visitBlock(Stmt::Block&)           override;
-    void visitIfStmt(Stmt::IfStmt&)         override;
-    void visitWhile(Stmt::While&)           override;
-    void visitControl(Stmt::LoopControl&)   override;
-    void visitForLoop(Stmt::ForLoop&)       override;
-    void visitFunction(Stmt::Function*)     override;
-    void visitReturn(Stmt::Return&)         override;
-    void visitKlass(Stmt::Klass&)           override;
+    enum class Engine
+    {
+        TreeWalker, Bytecode
+    };
+
+    // how the tree-walker gets from a node to its visit method
+    enum class Dispatch
+    {
+        Visitor, // virtual accept, then virtual visit
+        Switch   // switch over the stored node type, visits can be inlined
+    };
+
+    Interpreter(std::vector<Stmt::Base::Ptr> statements, Heap& heap, Logger& logger, Output::Mode output = Output::Mode::Block);
+    void interpret(Engine engine = Engine::Bytecode, Dispatch dispatch = Dispatch::Switch);
+
+    [[nodiscard]] Heap&   heap()   const { return heap_;   }
+    // the running bytecode engine, nullptr while walking the tree
+    [[nodiscard]] Vm*     vm()     const { return vm_;     }
+    // generator behind rand, randf and seed
+    [[nodiscard]] Random& random()       { return random_; }
+    // where print goes, on std::cout
+    [[nodiscard]] Output& output()       { return output_; }
+    // samples the Lox call stack of later runs, nullptr stops it
+    void profile(Profiler* profiler) { profiler_ = profiler; }
+
+    Completion visitExpression(Stmt::Expression&) override;
+    Completion visitPrint(Stmt::Print&)           override;
+    Completion visitVar(Stmt::Var&)               override;
+    Completion visitBlock(Stmt::Block&)           override;
+    Completion visitIfStmt(Stmt::IfStmt&)         override;
+    Completion visitWhile(Stmt::While&)           override;
+    Completion visitControl(Stmt::LoopControl&)   override;
+    Completion visitForLoop(Stmt::ForLoop&)       override;
+    Completion visitFunction(Stmt::Function*)     override;
+    Completion visitReturn(Stmt::Return&)         override;
+    Completion visitKlass(Stmt::Klass&)           override;
 
     Value visitCall(Expr::Call&)         override;
     Value visitAssign(Expr::Assign&)     override;
@@ -35,46 +64,92 @@ public:
 	Value visitGet(Expr::Get&)           override;
 	Value visitSet(Expr::Set&)           override;
 	Value visitThis(Expr::ThisKw&)       override;
-
-    void resolve(Expr::Base* expr, unsigned int distance);
 private:
 
     friend class Function;
+    friend class Vm;
 
-    class LoopControl
+    // makes a block environment current, restores the enclosing one on any exit
+    class EnterScope
     {
     public:
-        virtual ~LoopControl() = default;
-        [[nodiscard]] virtual Token controller() const = 0;
+        EnterScope(Interpreter& interpreter, Environment* local) :
+            interpreter_(interpreter), previous_(interpreter.environment_)
+        {
+            interpreter_.frames_.push_back(previous_);
+            interpreter_.environment_ = local;
+        }
+        EnterScope(const EnterScope&)              = delete;
+        EnterScope& operator = (const EnterScope&) = delete;
+        ~EnterScope()
+        {
+            interpreter_.environment_ = previous_;
+            interpreter_.frames_.pop_back();
+        }
+    private:
+        Interpreter& interpreter_;
+        Environment* previous_;
     };
 
-    class ContinueCnt : public LoopControl
+    // a fresh scope for a block or call: on the heap when the Resolver has found it captured, pooled otherwise
+    class NewScope
     {
     public:
-        explicit ContinueCnt(Token controller);
-        [[nodiscard]] Token controller() const override { return controller_; }
+        NewScope(Interpreter& interpreter, Environment* enclosing, const bool captured) :
+            scopes_(captured ? nullptr : &interpreter.scopes_),
+            environment_(captured ? interpreter.heap_.allocate<Environment>(enclosing) : scopes_->push(enclosing))
+        {
+        }
+        NewScope(const NewScope&)              = delete;
+        NewScope& operator = (const NewScope&) = delete;
+        ~NewScope()
+        {
+            if (scopes_) {
+                scopes_->pop();
+            }
+        }
+        [[nodiscard]] Environment* environment() const { return environment_; }
     private:
-        Token controller_;
+        ScopeStack*  scopes_;
+        Environment* environment_;
     };
 
-    class BreakCnt : public LoopControl
+    // the function on top of the profiled call stack of the tree-walker
+    class ProfileFrame
     {
     public:
-        explicit BreakCnt(Token controller);
-        [[nodiscard]] Token controller() const override { return controller_; }
+        ProfileFrame(Interpreter& interpreter, const std::string_view function) : profiler_(interpreter.profiler_)
+        {
+            if (profiler_) {
+                profiler_->enter(function);
+            }
+        }
+        ProfileFrame(const ProfileFrame&)              = delete;
+        ProfileFrame& operator = (const ProfileFrame&) = delete;
+        ~ProfileFrame()
+        {
+            if (profiler_) {
+                profiler_->leave();
+            }
+        }
     private:
-        Token controller_;
+        Profiler* profiler_;
     };
 
-    class ReturnCnt
+    // keeps intermediate values reachable while their expression is still being evaluated
+    class TempRoots
     {
     public:
-        ReturnCnt(Token keyword, Value value);
-        [[nodiscard]] Token keyword() const { return keyword_; }
-        [[nodiscard]] Value value()   const { return value_;   }
+        explicit TempRoots(Interpreter& interpreter) : temps_(interpreter.temps_), size_(temps_.size()) {}
+        TempRoots(const TempRoots&)              = delete;
+        TempRoots& operator = (const TempRoots&) = delete;
+        ~TempRoots() { temps_.resize(size_); }
+        void push(const Value& value) { temps_.push_back(value); }
+        // the last count values pushed, in place
+        [[nodiscard]] Args top(const size_t count) const { return { temps_.data() + temps_.size() - count, count }; }
     private:
-        Token keyword_;
-        Value value_;
+        std::vector<Value>& temps_;
+        size_t              size_;
     };
 
     class RuntimeError final : std::exception
@@ -89,14 +164,38 @@ private:
     };
 
     Value evaluate_(Expr::Base& expr);
-    void execute_(Stmt::Base& stmt);
-    void execute_block_(const std::list<Stmt::Base::Ptr>& statements, std::shared_ptr<Environment> local);
+    Completion execute_(Stmt::Base& stmt);
+    Completion execute_block_(const std::vector<Stmt::Base::Ptr>& statements, Environment* local);
+    // log records and script output both go to std::cout, in order
+    void flush_();
+    void collect_garbage_();
+    void walk_();
+    void run_bytecode_();
 
-    Value lookup_var_(Expr::Base* expr, const Token& token);
+    // calls a method straight on the receiver, without binding it first
+    Value invoke_(Expr::Get& get, Expr::Call& expr);
+    void check_arity_(const Callable& fun, size_t argc, const Token& paren) const;
+    Value binary_chain_(Expr::Binary& expr);
+    // evaluates the right operand and applies the operator, the left operand must be rooted by the caller
+    Value apply_binary_(Expr::Binary& expr, const Value& l);
+    // generic binary operators over evaluated operands, and/or excluded
+    Value binary_(const Expr::Binary& expr, const Value& l, const Value& r) const;
+    Value lookup_var_(const VarSlot& slot, const Token& token);
+    void define_var_(const VarSlot& slot, std::string_view name, const Value& value);
 
     std::vector<Stmt::Base::Ptr>        statements_;
+    Heap&                               heap_;
     Logger&                             logger_;
-    std::shared_ptr<Environment>        environment_;
-    std::shared_ptr<Environment>        global_;
-    std::map<Expr::Base*, unsigned int> locals_;
+    Environment*                        environment_;
+    Environment*                        global_;
+    Dispatch                            dispatch_;
+    std::vector<Environment*>           frames_;
+    ScopeStack                          scopes_;
+    std::vector<Value>                  temps_;
+    // left spines of the binary chains being evaluated, see binary_chain_
+    std::vector<Expr::Binary*>          chain_;
+    Vm*                                 vm_;
+    Random                              random_;
+    Output                              output_;
+    Profiler*                           profiler_;
 };
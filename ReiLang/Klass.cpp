@@ -1,9 +1,12 @@
 #include "Klass.hpp"
 #include "Instance.hpp"
+#include "Interpreter.hpp"
 
-Klass::Klass(std::string name, std::map<std::string, std::shared_ptr<Function>> methods):
+Klass::Klass(std::string name, Methods methods):
+    Callable(ObjectType::Klass),
     methods_(std::move(methods)),
-	name_(std::move(name))
+	name_(std::move(name)),
+	root_shape_(std::make_unique<Shape>())
 {
 }
 
@@ -12,9 +15,9 @@ std::string Klass::toString() const
     return name_;
 }
 
-Value Klass::call(Interpreter& interpreter, std::vector<Value> args)
+Value Klass::call(Interpreter& interpreter, Args /*args*/)
 {
-    return Value{ std::make_shared<Instance>(this) };
+    return Value{ interpreter.heap().allocate<Instance>(this) };
 }
 
 unsigned Klass::arity() const
@@ -22,10 +25,23 @@ unsigned Klass::arity() const
     return 0;
 }
 
-std::shared_ptr<Function> Klass::findMethod(const std::string& name) const
+Callable* Klass::findMethod(const std::string_view name) const
 {
-	if (methods_.find(name) != methods_.end()) {
-		return methods_.at(name);
+	const auto method = methods_.find(name);
+	if (method != methods_.end()) {
+		return method->second;
 	}
 	return nullptr;
 }
+
+void Klass::addMethod(const std::string& name, Callable* method)
+{
+	methods_[name] = method;
+}
+
+void Klass::trace(Heap& heap)
+{
+	for (auto& [_, m] : methods_) {
+		heap.mark(m);
+	}
+}
@@ -1,20 +1,28 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include "Callable.hpp"
+#include "Shape.hpp"
 #include <map>
-
-class Function;
+#include <memory>
 
 class Klass : public Callable
 {
 public:
-    Klass(std::string name, std::map<std::string, std::shared_ptr<Function>> methods);
+	using Methods = std::map<std::string, Callable*, std::less<>>;
+
+    Klass(std::string name, Methods methods);
     [[nodiscard]] std::string toString() const override;
-    Value call(Interpreter& interpreter, std::vector<Value> args) override;
+    Value call(Interpreter& interpreter, Args args) override;
     [[nodiscard]] unsigned arity() const override;
-	[[nodiscard]] std::shared_ptr<Function> findMethod(const std::string& name) const;
+    void trace(Heap& heap) override;
+	[[nodiscard]] Callable* findMethod(std::string_view name) const;
+	void addMethod(const std::string& name, Callable* method);
+	// shape of a fresh instance with no fields
+	[[nodiscard]] Shape* rootShape() const { return root_shape_.get(); }
 private:
-	std::map<std::string, std::shared_ptr<Function>> methods_;
+	Methods methods_;
 	std::string name_;
+	std::unique_ptr<Shape> root_shape_;
 };
 
@@ -1,47 +1,105 @@
 #include "Lexer.hpp"
+#include "Scan.hpp"
 
-Lexer::Lexer(std::string script, Logger& logger) :
-    script_(std::move(script)),
+#include <array>
+#include <charconv>
+
+namespace {
+
+struct Keyword
+{
+    std::string_view text;
+    TokenType        type = TokenType::Identifier;
+};
+
+constexpr Keyword keywords[] = {
+    { "and"     , TokenType::And      },
+    { "break"   , TokenType::Break    },
+    { "class"   , TokenType::Class    },
+    { "continue", TokenType::Continue },
+    { "else"    , TokenType::Else     },
+    { "false"   , TokenType::False    },
+    { "for"     , TokenType::For      },
+    { "fun"     , TokenType::Fun      },
+    { "if"      , TokenType::If       },
+    { "nil"     , TokenType::Nil      },
+    { "or"      , TokenType::Or       },
+    { "print"   , TokenType::Print    },
+    { "pure"    , TokenType::Pure     },
+    { "return"  , TokenType::Return   },
+    { "super"   , TokenType::Super    },
+    { "this"    , TokenType::This     },
+    { "true"    , TokenType::True     },
+    { "var"     , TokenType::Var      },
+    { "while"   , TokenType::While    }
+};
+
+// perfect for the keywords above, a new keyword may need other factors
+constexpr size_t keyword_hash(const std::string_view text)
+{
+    return (static_cast<unsigned char>(text.front()) * 7u + static_cast<unsigned char>(text.back()) + text.size()) & 31u;
+}
+
+constexpr std::array<Keyword, 32> make_keyword_table()
+{
+    std::array<Keyword, 32> table{};
+    for (const auto& keyword : keywords) {
+        table[keyword_hash(keyword.text)] = keyword;
+    }
+    return table;
+}
+
+constexpr auto keyword_table = make_keyword_table();
+
+constexpr bool keywords_collide()
+{
+    for (const auto& keyword : keywords) {
+        if (keyword_table[keyword_hash(keyword.text)].text != keyword.text) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static_assert(!keywords_collide(), "Two keywords share a hash bucket.");
+
+TokenType classify(const std::string_view text)
+{
+    const Keyword& keyword = keyword_table[keyword_hash(text)];
+    return keyword.text == text ? keyword.type : TokenType::Identifier;
+}
+
+}
+
+Lexer::Lexer(const std::string_view script, Logger& logger, const Mode mode) :
+    script_(script),
     start_(0),
     current_(0),
     line_(1),
-    keywords_({
-        { "and"     , TokenType::And      },
-        { "break"   , TokenType::Break    },
-        { "class"   , TokenType::Class    },
-        { "continue", TokenType::Continue },
-        { "else"    , TokenType::Else     },
-        { "false"   , TokenType::False    },
-        { "for"     , TokenType::For      },
-        { "fun"     , TokenType::Fun      },
-        { "if"      , TokenType::If       },
-        { "nil"     , TokenType::Nil      },
-        { "or"      , TokenType::Or       },
-        { "print"   , TokenType::Print    },
-        { "pure"    , TokenType::Pure     },
-        { "return"  , TokenType::Return   },
-        { "super"   , TokenType::Super    },
-        { "this"    , TokenType::This     },
-        { "true"    , TokenType::True     },
-        { "var"     , TokenType::Var      },
-        { "while"   , TokenType::While    }
-        }),
-    logger_(logger)
-{
-}
-
-std::vector<std::shared_ptr<Token>> Lexer::getTokens()
+    mode_(mode),
+    logger_(logger),
+    errors_(0),
+    finished_(false)
+{
+}
+
+Token Lexer::next()
 {
     while (!is_end_()) {
         start_ = current_;
+        token_.reset();
         get_next_token_();
+        if (token_) {
+            return *token_;
+        }
     }
-    tokens_.push_back(std::make_shared<Token>(TokenType::Eof, "eof", 0, line_));
-    if (logger_.count(LogLevel::Error) > 0) {
-        logger_.log(LogLevel::Fatal, "Bad lexing.");
+    if (!finished_) {
+        finished_ = true;
+        if (errors_ > 0) {
+            logger_.log(LogLevel::Fatal, "Bad lexing.");
+        }
     }
-    logger_.elapse("Lexing");
-    return tokens_;
+    return { TokenType::Eof, "eof", line_ };
 }
 
 bool Lexer::is_end_() const
@@ -81,10 +139,10 @@ void Lexer::get_next_token_()
 {
     const char c = advance_();
     switch (c) {
+    case '\n': ++line_; [[fallthrough]] ;
     case ' ' : [[fallthrough]] ;
     case '\t': [[fallthrough]] ;
-    case '\r':          break;
-    case '\n': ++line_; break;
+    case '\r': skip_blanks_(); break;
     case '(' : add_token_(TokenType::LeftParen);    break;
     case ')' : add_token_(TokenType::RightParen);   break;
     case '{' : add_token_(TokenType::LeftBrace);    break;
@@ -103,23 +161,16 @@ void Lexer::get_next_token_()
     case '>' : add_token_(match_('=') ? TokenType::GreaterEqual : TokenType::Greater); break;
     case '/' :
         if (match_('/')) {
-            while (peek_() != '\n' && !is_end_()) {
-                advance_();
-            }
+            skip_until_('\n');
         } else if (match_('*')) {
             const unsigned int start = line_;
             bool terminated = false;
             while (!is_end_()) {
-                if (peek_() == '\n') {
-                    ++line_;
-                }
-                if (peek_() == '*' && peek_next_() == '/') {
-                    advance_();
-                    advance_();
+                skip_until_('*');
+                if (match_('*') && match_('/')) {
                     terminated = true;
                     break;
                 }
-                advance_();
             }
             if (!terminated) {
                 logger_.log(LogLevel::Warning, start, "Unterminated comment.");
@@ -135,6 +186,7 @@ void Lexer::get_next_token_()
         } else if (isalpha(c) || c == '_') {
             make_identifier_();
         } else {
+            ++errors_;
             logger_.log(LogLevel::Error, line_, "Unexpected lexeme \"" + std::string(1, c) + "\".");
         }
     }
@@ -148,36 +200,25 @@ char Lexer::advance_()
 
 void Lexer::add_token_(TokenType type)
 {
-    const std::string text = script_.substr(start_, current_ - start_);
-    tokens_.push_back(std::make_shared<Token>(type, text, 0, line_));
+    token_.emplace(type, script_.substr(start_, current_ - start_), line_);
 }
 
 void Lexer::add_token_(double val)
 {
-    const std::string text = script_.substr(start_, current_ - start_);
-    tokens_.push_back(std::make_shared<Token>(TokenType::Number, text, val, line_));
-}
-
-void Lexer::add_token_(std::string val)
-{
-    const std::string text = script_.substr(start_, current_ - start_);
-    tokens_.push_back(std::make_shared<Token>(TokenType::String, text, val, line_));
+    token_.emplace(TokenType::Number, script_.substr(start_, current_ - start_), line_, val);
 }
 
 void Lexer::make_string_()
 {
     const unsigned int start = line_;
-    while (peek_() != '"' && !is_end_()) {
-        if (peek_() == '\n') {
-            ++line_;
-        } 
-        advance_();
-    }
+    skip_until_('"');
     if (is_end_()) {
+        ++errors_;
         logger_.log(LogLevel::Error, start, "Unterminated string.");
+        return;
     }
     advance_();
-    add_token_(script_.substr(start_ + 1, current_ - start_ - 2));
+    add_token_(TokenType::String);
 }
 
 void Lexer::make_number_()
@@ -191,18 +232,31 @@ void Lexer::make_number_()
             advance_();
         }
     }
-    add_token_(std::stod(script_.substr(start_, current_ - start_)));
+    double value = 0.0;
+    std::from_chars(script_.data() + start_, script_.data() + current_, value);
+    add_token_(value);
 }
 
 void Lexer::make_identifier_()
 {
-    while (isalpha(peek_()) || peek_() == '_' || isdigit(peek_())) {
-        advance_();
-    }
-    const std::string text = script_.substr(start_, current_ - start_);
-    if (keywords_.find(text) != keywords_.end()) {
-        add_token_(keywords_[text]);
-    } else {
-        add_token_(TokenType::Identifier);
-    }
+    skip_identifier_();
+    add_token_(classify(script_.substr(start_, current_ - start_)));
+}
+
+void Lexer::skip_blanks_()
+{
+    current_ = mode_ == Mode::Simd ? scan::simd::blanks(script_.data(), script_.size(), current_, line_)
+                                   : scan::scalar::blanks(script_.data(), script_.size(), current_, line_);
+}
+
+void Lexer::skip_until_(const char stop)
+{
+    current_ = mode_ == Mode::Simd ? scan::simd::until(script_.data(), script_.size(), current_, stop, line_)
+                                   : scan::scalar::until(script_.data(), script_.size(), current_, stop, line_);
+}
+
+void Lexer::skip_identifier_()
+{
+    current_ = mode_ == Mode::Simd ? scan::simd::identifier(script_.data(), script_.size(), current_)
+                                   : scan::scalar::identifier(script_.data(), script_.size(), current_);
 }
@@ -1,15 +1,23 @@
 #pragma once
+#include <optional>
 #include <string>
-#include <vector>
-#include <map>
+#include <string_view>
 #include "Token.hpp"
 #include "Logger.hpp"
 
 class Lexer final
 {
 public:
-    Lexer(std::string script, Logger& logger);
-    std::vector<std::shared_ptr<Token>> getTokens();
+    // how blanks, comments, strings and identifiers are skipped, see Scan.hpp
+    enum class Mode
+    {
+        Scalar, Simd
+    };
+
+    // the script is not copied, tokens point into it
+    Lexer(std::string_view script, Logger& logger, Mode mode = Mode::Simd);
+    // lexes on demand up to the next token, Eof for good once the script is over
+    Token next();
 private:
 
     [[nodiscard]] bool is_end_() const;
@@ -22,16 +30,20 @@ private:
     
     void add_token_(TokenType type);
     void add_token_(double val);
-    void add_token_(std::string val);
     void make_string_();
     void make_number_();
     void make_identifier_();
+    void skip_blanks_();
+    void skip_until_(char stop);
+    void skip_identifier_();
 
-    std::string                         script_;
-    size_t                              start_;
-    size_t                              current_;
-    unsigned int                        line_;
-    std::vector<std::shared_ptr<Token>> tokens_;
-    std::map<std::string, TokenType>    keywords_;
-    Logger&                             logger_;
+    std::string_view     script_;
+    size_t               start_;
+    size_t               current_;
+    unsigned int         line_;
+    std::optional<Token> token_;
+    Mode                 mode_;
+    Logger&              logger_;
+    unsigned int         errors_;
+    bool                 finished_;
 };
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+//
+// Bounded lock-free queue between exactly one producer and one consumer thread.
+// Head and tail only ever grow; they sit on separate cache lines so the two sides do not share one.
+//
+template <typename T, std::size_t Capacity>
+class LogRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two.");
+public:
+    LogRing() : slots_(std::make_unique<T[]>(Capacity)) {}
+    LogRing(const LogRing&)              = delete;
+    LogRing& operator = (const LogRing&) = delete;
+
+    // producer side, false when the ring is full
+    bool tryPush(const T& item)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, false when the ring is empty
+    bool tryPop(T& item)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+private:
+    std::unique_ptr<T[]>                 slots_;
+    alignas(64) std::atomic<std::size_t> head_{ 0 };
+    alignas(64) std::atomic<std::size_t> tail_{ 0 };
+};
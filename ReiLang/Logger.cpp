@@ -1,4 +1,5 @@
 #include "Logger.hpp"
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
@@ -20,53 +21,127 @@ const char* to_string(LogLevel e)
     }
 }
 
-Logger::Logger(std::ostream& stream) :
+Logger::Logger(std::ostream& stream, const Mode mode, const Overflow overflow) :
     stream_(stream),
     log_count_{ 0 },
-    start_(std::chrono::high_resolution_clock::now())
+    threshold_(min_log_level),
+    overflow_(overflow),
+    pushed_(0),
+    written_(0),
+    stopping_(false)
 {
+    if (mode == Mode::Async) {
+        ring_ = std::make_unique<LogRing<Record, 1024>>();
+        writer_ = std::thread{ &Logger::drain_, this };
+    }
+}
+
+Logger::~Logger()
+{
+    if (writer_.joinable()) {
+        stopping_.store(true, std::memory_order_release);
+        writer_.join();
+    }
 }
 
 void Logger::log(const LogLevel level, unsigned int line, const std::string& msg)
+{
+    submit_(level, line, msg);
+}
+
+void Logger::log(LogLevel level, const std::string& msg)
+{
+    submit_(level, no_line_, msg);
+}
+
+void Logger::flush()
+{
+    if (ring_) {
+        while (written_.load(std::memory_order_acquire) != pushed_) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void Logger::submit_(const LogLevel level, const unsigned int line, const std::string_view msg)
 {
 #ifndef SILENCE
-    if (level == LogLevel::Debug) {
-    #ifdef _DEBUG
-        stream_ << std::left << std::setw(7) << to_string(level) << " [ line " << std::right << std::setw(5) << line << " ] " << msg << "\n";
-    #endif
-    } else {
-        stream_ << std::left << std::setw(7) << to_string(level) << " [ line " << std::right << std::setw(5) << line << " ] " << msg << "\n";
+    if (enabled(level)) {
+        if (ring_) {
+            push_(level, line, msg);
+        } else {
+            write_(level, line, msg);
+        }
     }
 #endif
     log_count_[int(level)]++;
 }
 
-void Logger::log(LogLevel level, const std::string& msg)
+void Logger::push_(const LogLevel level, const unsigned int line, const std::string_view msg)
 {
-#ifndef SILENCE
-    if (level == LogLevel::Debug) {
-    #ifdef _DEBUG
-        stream_ << std::left << std::setw(7) << to_string(level) << " [            ] " << msg << "\n";
-    #endif
+    Record record;
+    record.level = level;
+    record.line = line;
+    record.size = static_cast<std::uint16_t>(std::min(msg.size(), sizeof record.text));
+    std::memcpy(record.text, msg.data(), record.size);
+    if (record.size < msg.size()) {
+        ++stats_.truncated;
     }
-    else {
-        stream_ << std::left << std::setw(7) << to_string(level) << " [            ] " << msg << "\n";
+    bool waited = false;
+    while (!ring_->tryPush(record)) {
+        if (level < LogLevel::Warning && overflow_ == Overflow::Drop) {
+            ++stats_.dropped;
+            return;
+        }
+        waited = true;
+        std::this_thread::yield();
+    }
+    stats_.waited += waited;
+    ++pushed_;
+}
+
+void Logger::write_(const LogLevel level, const unsigned int line, const std::string_view msg)
+{
+    stream_ << std::left << std::setw(7) << to_string(level);
+    if (line == no_line_) {
+        stream_ << " [            ] ";
+    } else {
+        stream_ << " [ line " << std::right << std::setw(5) << line << " ] ";
+    }
+    stream_ << msg << "\n";
+}
+
+void Logger::drain_()
+{
+    Record record;
+    while (true) {
+        // whatever was pushed before stopping is still written
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+        std::size_t written = 0;
+        while (ring_->tryPop(record)) {
+            write_(record.level, record.line, { record.text, record.size });
+            ++written;
+        }
+        if (written > 0) {
+            stream_.flush();
+            written_.fetch_add(written, std::memory_order_release);
+        } else if (stopping) {
+            return;
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+        }
     }
-#endif
-    log_count_[int(level)]++;
 }
 
 void Logger::elapse(const std::string& event)
 {
-    const auto end = std::chrono::high_resolution_clock::now();
-    const auto start = std::chrono::time_point_cast<std::chrono::milliseconds>(start_).time_since_epoch().count();
-    const auto stop  = std::chrono::time_point_cast<std::chrono::milliseconds>(end).time_since_epoch().count();
-    const auto duration = stop - start;
-    start_ = end;
-    std::ostringstream strout;
-    strout << duration;
-    std::string str = strout.str();
-    log(LogLevel::Info, event + " duration: " + str + " ms.");
+    const auto& phase = timings_.lap(event);
+    REI_LOG(*this, LogLevel::Info, [&phase] {
+        std::ostringstream strout;
+        strout << phase.name << " duration: " << std::fixed << std::setprecision(3)
+               << std::chrono::duration<double, std::milli>{ phase.duration }.count() << " ms.";
+        return strout.str();
+    }());
 }
 
 void Logger::clearStat()
@@ -78,6 +153,11 @@ void Logger::clearStat()
 
 void Logger::showStat()
 {
+    flush();
+    if (stats_.dropped > 0 || stats_.waited > 0 || stats_.truncated > 0) {
+        stream_ << "Log records: " << stats_.dropped << " dropped, " << stats_.waited << " waited for room, "
+                << stats_.truncated << " truncated.\n";
+    }
     stream_ << "\n===== Total: warnings: " << log_count_[int(LogLevel::Warning)] << ", errors: " << log_count_[int(LogLevel::Error)] << " =====\n";
 }
 
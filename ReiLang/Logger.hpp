@@ -1,6 +1,15 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <ostream>
 #include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "LogRing.hpp"
+#include "Timings.hpp"
 
 #define SILENCE_
 
@@ -15,25 +24,107 @@ enum class LogLevel
 
 const char* to_string(LogLevel e);
 
+//
+// Messages under this level are compiled out of REI_LOG call sites, 0 for Debug up to 1 for Info;
+// warnings and errors are always reported since the pipeline stops on them.
+//
+#ifndef REI_LOG_MIN_LEVEL
+    #ifdef _DEBUG
+        #define REI_LOG_MIN_LEVEL 0
+    #else
+        #define REI_LOG_MIN_LEVEL 1
+    #endif
+#endif
+
+constexpr LogLevel min_log_level = static_cast<LogLevel>(REI_LOG_MIN_LEVEL);
+static_assert(min_log_level <= LogLevel::Info, "Warnings and errors cannot be compiled out.");
+
+//
+// Logs a message that is only built when its level is enabled, at compile time and then at run time:
+// REI_LOG(logger_, LogLevel::Debug, "slot " + std::to_string(slot));
+//
+#define REI_LOG(logger, level, ...)                               \
+    do {                                                          \
+        if constexpr ((level) >= min_log_level) {                 \
+            if ((logger).enabled(level)) {                        \
+                (logger).log((level), __VA_ARGS__);               \
+            }                                                     \
+        }                                                         \
+    } while (false)
+
 class Logger
 {
 public:
-    explicit Logger(std::ostream& stream);
+    // Async hands log records to a background thread that formats and writes them
+    enum class Mode
+    {
+        Sync, Async
+    };
+
+    // what an async logger does with Debug and Info records while its ring is full,
+    // warnings and errors always wait
+    enum class Overflow
+    {
+        Drop, Wait
+    };
+
+    struct Stats
+    {
+        std::size_t dropped   = 0;
+        std::size_t waited    = 0;
+        std::size_t truncated = 0;
+    };
+
+    explicit Logger(std::ostream& stream, Mode mode = Mode::Sync, Overflow overflow = Overflow::Drop);
 
     Logger(const Logger&)              = delete;
     Logger(Logger&&)                   = delete;
     Logger& operator = (const Logger&) = delete;
     Logger& operator = (Logger&&)      = delete;
-    ~Logger()                          = default;
+    ~Logger();
 
     void log(LogLevel level, unsigned int line, const std::string& msg);
     void log(LogLevel level, const std::string& msg);
+    // messages under the threshold are counted but not written; it never mutes warnings and errors
+    void setLevel(LogLevel level) { threshold_ = std::min(level, LogLevel::Warning); }
+    [[nodiscard]] bool enabled(const LogLevel level) const { return level >= threshold_; }
+    // ends a phase of the pipeline, see Timings
     void elapse(const std::string& event);
     void clearStat();
     void showStat();
     [[nodiscard]] unsigned int count(LogLevel level) const;
+    // returns once everything logged so far has been written
+    void flush();
+    [[nodiscard]] const Stats& stats() const { return stats_; }
+    [[nodiscard]] Timings&     timings()     { return timings_; }
 private:
+    static constexpr unsigned int no_line_ = ~0u;
+
+    // fixed size so it is copied through the ring as is, longer messages are cut
+    struct Record
+    {
+        LogLevel      level;
+        unsigned int  line;
+        std::uint16_t size;
+        char          text[246];
+    };
+
+    void submit_(LogLevel level, unsigned int line, std::string_view msg);
+    void push_(LogLevel level, unsigned int line, std::string_view msg);
+    void write_(LogLevel level, unsigned int line, std::string_view msg);
+    // body of the writer thread
+    void drain_();
+
     std::ostream& stream_;
     unsigned int log_count_[5];
-    std::chrono::time_point<std::chrono::high_resolution_clock> start_;
+    LogLevel      threshold_;
+    Timings       timings_;
+
+    Overflow                                overflow_;
+    Stats                                   stats_;
+    std::unique_ptr<LogRing<Record, 1024>>  ring_;
+    std::size_t                             pushed_;
+    std::atomic<std::size_t>                written_;
+    std::atomic<bool>                       stopping_;
+    std::thread                             writer_;
 };
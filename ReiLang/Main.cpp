@@ -1,38 +1,169 @@
-#include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <iostream>
 #include <string>
+#include <string_view>
 
 #include "Resolver.hpp"
 #include "Parser.hpp"
+#include "Interpreter.hpp"
+#include "Optimizer.hpp"
+#include "Source.hpp"
+
+struct Options
+{
+    Heap::Config        gc;
+    Interpreter::Engine   engine        = Interpreter::Engine::Bytecode;
+    Interpreter::Dispatch dispatch      = Interpreter::Dispatch::Switch;
+    Lexer::Mode           lexer         = Lexer::Mode::Simd;
+    bool                  benchLexer    = false;
+    bool                  benchDispatch = false;
+    bool                  fold          = true;
+    Output::Mode          output        = Output::Mode::Block;
+    LogLevel              logLevel      = min_log_level;
+    Logger::Mode          logMode       = Logger::Mode::Sync;
+    Logger::Overflow      logOverflow   = Logger::Overflow::Drop;
+    // where the phase timings go as JSON, nowhere when empty
+    std::string           timings;
+    // where the sampled stacks go folded, the per-line table to the same name plus ".lines"; no sampling when empty
+    std::string           profile;
+    unsigned long         profileInterval = 1000;
+};
 
-void run(const std::string& script)
+// folded stacks as flamegraph.pl takes them, and the per-line table next to them
+void writeProfile(const Profiler& profiler, const std::string& path, Logger& logger)
 {
-    Logger      logger{ std::cout };
-    Lexer       lexer = Lexer{ script, logger };
-    Parser      parser{ lexer.getTokens(), logger };
-    const auto statements = parser.parse();
-    Interpreter interpreter{ statements, logger };
-    Resolver    resolver{ interpreter, logger };
-    resolver.resolve(statements);
-    interpreter.interpret();
+    std::ofstream folded{ path };
+    profiler.writeFolded(folded);
+    std::ofstream lines{ path + ".lines" };
+    profiler.writeLines(lines);
+    if (!folded || !lines) {
+        logger.log(LogLevel::Warning, "Cannot write profile to " + path + ".");
+    } else {
+        logger.log(LogLevel::Info, std::to_string(profiler.samples()) + " samples written to " + path + ".");
+    }
+}
+
+// everything up to interpreting, literals go to the current heap
+Program compile(const std::string_view script, const Options& options, Logger& logger)
+{
+    Lexer    lexer{ script, logger, options.lexer };
+    Parser   parser{ lexer, logger };
+    Program  program = parser.parse();
+    Resolver resolver{ logger };
+    resolver.resolve(program.statements());
+    if (options.fold) {
+        Optimizer optimizer{ program, logger };
+        optimizer.optimize();
+    }
+    return program;
+}
+
+void run(const std::string_view script, const Options& options)
+{
+    Logger      logger{ std::cout, options.logMode, options.logOverflow };
+    logger.setLevel(options.logLevel);
+    Heap        heap{ logger, options.gc };
+    logger.timings().watch(heap);
+    Program     program = compile(script, options, logger);
+    Interpreter interpreter{ program.statements(), heap, logger, options.output };
+    Profiler    profiler{ std::chrono::microseconds{ options.profileInterval } };
+    if (!options.profile.empty()) {
+        interpreter.profile(&profiler);
+        profiler.start();
+    }
+    interpreter.interpret(options.engine, options.dispatch);
+    if (!options.profile.empty()) {
+        profiler.stop();
+        writeProfile(profiler, options.profile, logger);
+    }
+    if (!options.timings.empty()) {
+        std::ofstream file{ options.timings };
+        logger.timings().writeJson(file);
+        if (!file) {
+            logger.log(LogLevel::Warning, "Cannot write timings to " + options.timings + ".");
+        }
+    }
     logger.showStat();
     std::cout << "\n";
 }
 
-void runFile(const char* file)
+// lexes the script over and over without running it and reports the throughput
+void benchLexer(const std::string_view script, const Options& options)
+{
+    constexpr int passes = 20;
+    std::ostream  sink{ nullptr };
+    Logger        logger{ sink };
+    size_t        tokens = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < passes; i++) {
+        Lexer lexer{ script, logger, options.lexer };
+        tokens = 1;
+        while (lexer.next().type != TokenType::Eof) {
+            ++tokens;
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double megabytes = static_cast<double>(script.size()) * passes / (1024.0 * 1024.0);
+    std::cout << "Lexed " << tokens << " tokens " << passes << " times, " << megabytes << " MB in " << elapsed.count() << " s: "
+              << megabytes / elapsed.count() << " MB/s\n";
+}
+
+// walks the script with each dispatch style in turn, output discarded, and reports the best time of each;
+// the script is compiled afresh for every walk since nodes cache state of the interpreter that ran them
+void benchDispatch(const std::string_view script, const Options& options)
 {
-    std::ifstream fin{ file };
-    if (fin) {
-        const std::string content{ (std::istreambuf_iterator<char>(fin)), (std::istreambuf_iterator<char>()) };
-        run(content);
+    using Dispatch = Interpreter::Dispatch;
+    using Seconds  = std::chrono::duration<double>;
+    constexpr int passes = 5;
+    std::ostream  sink{ nullptr };
+    Seconds       best[] = { Seconds::max(), Seconds::max() };
+    std::streambuf* const out = std::cout.rdbuf(nullptr);
+    for (int i = 0; i < passes; i++) {
+        for (const Dispatch dispatch : { Dispatch::Visitor, Dispatch::Switch }) {
+            Logger      logger{ sink };
+            Heap        heap{ logger, options.gc };
+            Program     program = compile(script, options, logger);
+            Interpreter interpreter{ program.statements(), heap, logger };
+            const auto start = std::chrono::steady_clock::now();
+            interpreter.interpret(Interpreter::Engine::TreeWalker, dispatch);
+            Seconds& time = best[static_cast<int>(dispatch)];
+            time = std::min<Seconds>(time, std::chrono::steady_clock::now() - start);
+        }
     }
-    else {
-        throw std::exception("Bad file.");
+    std::cout.rdbuf(out);
+    std::cout << "Best of " << passes << " walks: visitor " << best[0].count() << " s, switch " << best[1].count()
+              << " s, speedup " << best[0] / best[1] << "\n";
+}
+
+void runSource(const Source& source, const Options& options)
+{
+    if (options.benchLexer) {
+        benchLexer(source.text(), options);
+    } else if (options.benchDispatch) {
+        benchDispatch(source.text(), options);
+    } else {
+        run(source.text(), options);
     }
 }
 
-void runPrompt()
+// "-" reads the script from stdin
+void runFile(const char* file, const Options& options)
 {
+    if (std::string_view{ file } == "-") {
+        const Source source{ std::cin };
+        runSource(source, options);
+    } else {
+        const Source source{ file };
+        runSource(source, options);
+    }
+}
+
+// prints show up as soon as each line is interpreted
+void runPrompt(Options options)
+{
+    options.output = Output::Mode::Line;
     std::string expression;
     while (true) {
         std::cout << "|||| ";
@@ -43,21 +174,103 @@ void runPrompt()
         if (expression == "q!") {
             break;
         }
-        run(expression);
+        run(expression, options);
+    }
+}
+
+// levels --log-level takes, debug only where REI_LOG keeps Debug call sites
+constexpr const char* log_levels = min_log_level > LogLevel::Debug ? "info|warning" : "debug|info|warning";
+
+bool parseOption(const std::string& arg, Options& options)
+{
+    const auto value = [&arg](const std::string& prefix) { return arg.substr(prefix.size()); };
+    if (arg.rfind("--gc-threshold=", 0) == 0) {
+        options.gc.initialThreshold = std::stoul(value("--gc-threshold="));
+        return true;
+    }
+    if (arg.rfind("--gc-growth=", 0) == 0) {
+        options.gc.growthFactor = std::stod(value("--gc-growth="));
+        return options.gc.growthFactor > 1.0;
+    }
+    if (arg == "--engine=vm" || arg == "--engine=ast") {
+        options.engine = arg == "--engine=vm" ? Interpreter::Engine::Bytecode : Interpreter::Engine::TreeWalker;
+        return true;
+    }
+    if (arg == "--lexer=simd" || arg == "--lexer=scalar") {
+        options.lexer = arg == "--lexer=simd" ? Lexer::Mode::Simd : Lexer::Mode::Scalar;
+        return true;
+    }
+    if (arg == "--log-level=debug" || arg == "--log-level=info" || arg == "--log-level=warning") {
+        const std::string level = value("--log-level=");
+        if (level == "debug" && min_log_level > LogLevel::Debug) {
+            std::cout << "Debug messages are compiled out of this build, see REI_LOG_MIN_LEVEL.\n";
+            return false;
+        }
+        options.logLevel = level == "debug" ? LogLevel::Debug : level == "info" ? LogLevel::Info : LogLevel::Warning;
+        return true;
+    }
+    if (arg.rfind("--timings=", 0) == 0) {
+        options.timings = value("--timings=");
+        return !options.timings.empty();
+    }
+    if (arg.rfind("--profile=", 0) == 0) {
+        options.profile = value("--profile=");
+        return !options.profile.empty();
+    }
+    if (arg.rfind("--profile-interval=", 0) == 0) {
+        options.profileInterval = std::stoul(value("--profile-interval="));
+        return options.profileInterval > 0;
+    }
+    if (arg == "--async-log") {
+        options.logMode = Logger::Mode::Async;
+        return true;
+    }
+    if (arg == "--log-overflow=drop" || arg == "--log-overflow=wait") {
+        options.logOverflow = arg == "--log-overflow=drop" ? Logger::Overflow::Drop : Logger::Overflow::Wait;
+        return true;
+    }
+    if (arg == "--line-buffered") {
+        options.output = Output::Mode::Line;
+        return true;
+    }
+    if (arg == "--no-fold") {
+        options.fold = false;
+        return true;
+    }
+    if (arg == "--dispatch=switch" || arg == "--dispatch=visitor") {
+        options.dispatch = arg == "--dispatch=switch" ? Interpreter::Dispatch::Switch : Interpreter::Dispatch::Visitor;
+        return true;
+    }
+    if (arg == "--bench-lexer") {
+        options.benchLexer = true;
+        return true;
+    }
+    if (arg == "--bench-dispatch") {
+        options.benchDispatch = true;
+        return true;
     }
+    return false;
 }
 
 int main(int argc, char* argv[])
 {
     try {
-        if (argc > 2) {
-            std::cout << "Usage: rei [filepath]\n";
+        Options options;
+        const char* file = nullptr;
+        for (int i = 1; i < argc; i++) {
+            const std::string arg{ argv[i] };
+            if (arg.rfind("--", 0) != 0 && !file) {
+                file = argv[i];
+            } else if (!parseOption(arg, options)) {
+                std::cout << "Usage: rei [--engine=vm|ast] [--dispatch=switch|visitor] [--lexer=simd|scalar] [--bench-lexer] [--bench-dispatch] [--no-fold] [--line-buffered] [--log-level=" << log_levels << "] [--async-log] [--log-overflow=drop|wait] [--timings=FILE] [--profile=FILE] [--profile-interval=MICROSECONDS] [--gc-threshold=BYTES] [--gc-growth=FACTOR] [filepath|-]\n";
+                return 1;
+            }
         }
-        else if (argc == 2) {
-            runFile(argv[1]);
+        if (file) {
+            runFile(file, options);
         }
         else {
-            runFile(R"(c:\Users\rodchenkov.sn\Desktop\demo.lox)");
+            runFile(R"(c:\Users\rodchenkov.sn\Desktop\demo.lox)", options);
         }
     } catch (const std::exception& e) {
         std::cout << e.what() << "\n";
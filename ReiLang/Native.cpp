@@ -0,0 +1,27 @@
+#include "Native.hpp"
+
+Native::Native(const Nullary entry) :
+    Callable(ObjectType::Native),
+    arity_(0)
+{
+    entry_.nullary = entry;
+}
+
+Native::Native(const Unary entry) :
+    Callable(ObjectType::Native),
+    arity_(1)
+{
+    entry_.unary = entry;
+}
+
+Native::Native(const Binary entry) :
+    Callable(ObjectType::Native),
+    arity_(2)
+{
+    entry_.binary = entry;
+}
+
+Value Native::call(Interpreter& interpreter, const Args args)
+{
+    return enter(interpreter, args.begin());
+}
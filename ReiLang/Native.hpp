@@ -0,0 +1,40 @@
+#pragma once
+#include "Callable.hpp"
+
+//
+// Function implemented in C++, taking its arguments unpacked through a plain function pointer.
+// Call sites that have checked the arity call enter() directly, without call() and its argument span.
+//
+class Native : public Callable
+{
+public:
+    using Nullary = Value (*)(Interpreter& interpreter);
+    using Unary   = Value (*)(Interpreter& interpreter, Value a);
+    using Binary  = Value (*)(Interpreter& interpreter, Value a, Value b);
+
+    explicit Native(Nullary entry);
+    explicit Native(Unary entry);
+    explicit Native(Binary entry);
+
+    [[nodiscard]] unsigned arity() const final { return arity_; }
+    Value call(Interpreter& interpreter, Args args) final;
+    // args holds exactly arity() values
+    Value enter(Interpreter& interpreter, const Value* args) const
+    {
+        switch (arity_) {
+        case 0:  return entry_.nullary(interpreter);
+        case 1:  return entry_.unary(interpreter, args[0]);
+        default: return entry_.binary(interpreter, args[0], args[1]);
+        }
+    }
+private:
+    union Entry
+    {
+        Nullary nullary;
+        Unary   unary;
+        Binary  binary;
+    };
+
+    unsigned arity_;
+    Entry    entry_;
+};
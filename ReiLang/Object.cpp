@@ -0,0 +1,29 @@
+#include "Object.hpp"
+#include <utility>
+
+const char* to_string(ValueType e)
+{
+    switch (e) {
+    case ValueType::Nil      : return "Nil";
+    case ValueType::Bool     : return "Bool";
+    case ValueType::Number   : return "Number";
+    case ValueType::String   : return "String";
+    case ValueType::Callable : return "Callable";
+    case ValueType::Instance : return "Instance";
+    default : return "unknown";
+    }
+}
+
+Object::Object(const ObjectType type):
+    type_(type),
+    marked_(false),
+    size_(0),
+    next_(nullptr)
+{
+}
+
+StringObject::StringObject(std::string value):
+    Object(ObjectType::String),
+    value_(std::move(value))
+{
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+enum class ValueType
+{
+    Nil,
+    Bool,
+    Number,
+    String,
+    Callable,
+    Instance
+};
+
+const char* to_string(ValueType e);
+
+enum class ObjectType
+{
+    String,
+    Callable,
+    Klass,
+    Function,
+    Native,
+    Closure,
+    BoundMethod,
+    Instance,
+    Environment,
+    Prototype,
+    Upvalue
+};
+
+class Heap;
+
+//
+// Common header of every garbage-collected object.
+// Objects are created only through Heap::allocate and never deleted by hand.
+//
+class Object
+{
+public:
+    explicit Object(ObjectType type);
+
+    Object(const Object&)              = delete;
+    Object(Object&&)                   = delete;
+    Object& operator = (const Object&) = delete;
+    Object& operator = (Object&&)      = delete;
+    virtual ~Object()                  = default;
+
+    [[nodiscard]] ObjectType objectType() const { return type_; }
+
+    // marks every object directly reachable from this one
+    virtual void trace(Heap& /*heap*/) {}
+    // bytes owned by the object outside of its own footprint
+    [[nodiscard]] virtual std::size_t extent() const { return 0; }
+private:
+    friend class Heap;
+
+    ObjectType   type_;
+    bool         marked_;
+    std::size_t  size_;
+    Object*      next_;
+};
+
+class StringObject final : public Object
+{
+public:
+    explicit StringObject(std::string value);
+    [[nodiscard]] const std::string& str() const { return value_; }
+    [[nodiscard]] std::size_t extent() const override { return value_.capacity(); }
+private:
+    std::string value_;
+};
@@ -0,0 +1,265 @@
+#include "Optimizer.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include "Heap.hpp"
+
+namespace {
+
+bool is_literal(const Expr::Base::Ptr expr)
+{
+    return expr->type() == AstNodeType::Literal;
+}
+
+Value value_of(const Expr::Base::Ptr expr)
+{
+    return static_cast<Expr::Literal*>(expr)->value();
+}
+
+}
+
+Optimizer::Optimizer(Program& program, Logger& logger):
+    program_(program),
+    logger_(logger),
+    folded_(0)
+{
+}
+
+void Optimizer::optimize()
+{
+    if (logger_.count(LogLevel::Fatal) > 0) {
+        return;
+    }
+    optimize_(program_.statements());
+    REI_LOG(logger_, LogLevel::Debug, "Folded " + std::to_string(folded_) + " nodes.");
+    logger_.elapse("Optimizing");
+}
+
+Expr::Base::Ptr Optimizer::fold_(const Expr::Base::Ptr expr)
+{
+    switch (expr->type()) {
+    case AstNodeType::Grouping:
+        ++folded_;
+        return fold_(static_cast<Expr::Grouping*>(expr)->expression_);
+    case AstNodeType::Ternary: {
+        auto& ternary = *static_cast<Expr::Ternary*>(expr);
+        ternary.condition_ = fold_(ternary.condition_);
+        if (is_literal(ternary.condition_)) {
+            ++folded_;
+            return fold_(value_of(ternary.condition_).isTrue() ? ternary.if_true_ : ternary.if_false_);
+        }
+        ternary.if_true_  = fold_(ternary.if_true_);
+        ternary.if_false_ = fold_(ternary.if_false_);
+        return expr;
+    }
+    case AstNodeType::Binary:
+        return fold_binary_(*static_cast<Expr::Binary*>(expr));
+    case AstNodeType::Unary:
+        return fold_unary_(*static_cast<Expr::Unary*>(expr));
+    case AstNodeType::Call: {
+        auto& call = *static_cast<Expr::Call*>(expr);
+        call.callee_ = fold_(call.callee_);
+        for (auto& argument : call.arguments_) {
+            argument = fold_(argument);
+        }
+        return expr;
+    }
+    case AstNodeType::Get: {
+        auto& get = *static_cast<Expr::Get*>(expr);
+        get.object_ = fold_(get.object_);
+        return expr;
+    }
+    case AstNodeType::Set: {
+        auto& set = *static_cast<Expr::Set*>(expr);
+        set.object_ = fold_(set.object_);
+        set.value_  = fold_(set.value_);
+        return expr;
+    }
+    case AstNodeType::Assign: {
+        auto& assign = *static_cast<Expr::Assign*>(expr);
+        assign.value_ = fold_(assign.value_);
+        return expr;
+    }
+    case AstNodeType::Function:
+        optimize_(static_cast<Expr::Lambda*>(expr)->body_);
+        return expr;
+    default:
+        return expr;
+    }
+}
+
+// the left spine of a + b + c ... with a loop, so that a generated chain of any length costs no C++ stack
+Expr::Base::Ptr Optimizer::fold_binary_(Expr::Binary& expr)
+{
+    std::vector<Expr::Binary*> chain;
+    Expr::Base::Ptr left = &expr;
+    while (left->type() == AstNodeType::Binary) {
+        chain.push_back(static_cast<Expr::Binary*>(left));
+        left = chain.back()->left_;
+    }
+    Expr::Base::Ptr folded = fold_(left);
+    for (auto node = chain.rbegin(); node != chain.rend(); ++node) {
+        (*node)->left_ = folded;
+        folded = fold_operator_(**node);
+    }
+    return folded;
+}
+
+Expr::Base::Ptr Optimizer::fold_operator_(Expr::Binary& expr)
+{
+    const TokenType oper = expr.oper_.type;
+    // the right side of a short circuit is never evaluated, it can go whatever it is
+    if (is_literal(expr.left_)) {
+        const bool left = value_of(expr.left_).isTrue();
+        if ((oper == TokenType::And && !left) || (oper == TokenType::Or && left)) {
+            return literal_(Value{ left });
+        }
+    }
+    expr.right_ = fold_(expr.right_);
+    if (!is_literal(expr.left_) || !is_literal(expr.right_)) {
+        return &expr;
+    }
+    const Value l = value_of(expr.left_);
+    const Value r = value_of(expr.right_);
+    try {
+        switch (oper) {
+        case TokenType::Plus:         return literal_(l + r);
+        case TokenType::Minus:        return literal_(l - r);
+        case TokenType::Star:         return literal_(l * r);
+        case TokenType::Slash:        return literal_(l / r);
+        case TokenType::EqualEqual:   return literal_(l == r);
+        case TokenType::BangEqual:    return literal_(l != r);
+        case TokenType::Less:         return literal_(l < r);
+        case TokenType::LessEqual:    return literal_(l <= r);
+        case TokenType::Greater:      return literal_(l > r);
+        case TokenType::GreaterEqual: return literal_(l >= r);
+        case TokenType::And:          return literal_(l && r);
+        case TokenType::Or:           return literal_(l || r);
+        default:                      return &expr;
+        }
+    } catch (const ValueOperationException&) {
+        return &expr;
+    }
+}
+
+Expr::Base::Ptr Optimizer::fold_unary_(Expr::Unary& expr)
+{
+    expr.operand_ = fold_(expr.operand_);
+    if (!is_literal(expr.operand_)) {
+        return &expr;
+    }
+    const Value operand = value_of(expr.operand_);
+    try {
+        switch (expr.oper_.type) {
+        case TokenType::Minus: return literal_(-operand);
+        case TokenType::Bang:  return literal_(!operand);
+        default:               return &expr;
+        }
+    } catch (const ValueOperationException&) {
+        return &expr;
+    }
+}
+
+// folded strings are pinned like the parsed ones; counts the node the literal stands in for
+Expr::Base::Ptr Optimizer::literal_(const Value& value)
+{
+    ++folded_;
+    Heap::current().pin(value);
+    return program_.make<Expr::Literal>(value);
+}
+
+Stmt::Base::Ptr Optimizer::optimize_(const Stmt::Base::Ptr statement)
+{
+    switch (statement->type()) {
+    case AstNodeType::Expression: {
+        auto& stmt = *static_cast<Stmt::Expression*>(statement);
+        stmt.expr_ = fold_(stmt.expr_);
+        return is_literal(stmt.expr_) ? nullptr : statement;
+    }
+    case AstNodeType::Print: {
+        auto& stmt = *static_cast<Stmt::Print*>(statement);
+        stmt.expr_ = fold_(stmt.expr_);
+        return statement;
+    }
+    case AstNodeType::Var: {
+        auto& stmt = *static_cast<Stmt::Var*>(statement);
+        if (stmt.expr_) {
+            stmt.expr_ = fold_(stmt.expr_);
+        }
+        return statement;
+    }
+    case AstNodeType::Block:
+        optimize_(static_cast<Stmt::Block*>(statement)->statements_);
+        return statement;
+    case AstNodeType::IfStmt: {
+        auto& stmt = *static_cast<Stmt::IfStmt*>(statement);
+        stmt.condition_ = fold_(stmt.condition_);
+        if (is_literal(stmt.condition_)) {
+            ++folded_;
+            const auto branch = value_of(stmt.condition_).isTrue() ? stmt.then_branch_ : stmt.else_branch_;
+            return branch ? optimize_(branch) : nullptr;
+        }
+        stmt.then_branch_ = required_(stmt.then_branch_);
+        if (stmt.else_branch_) {
+            stmt.else_branch_ = optimize_(stmt.else_branch_);
+        }
+        return statement;
+    }
+    case AstNodeType::While: {
+        auto& stmt = *static_cast<Stmt::While*>(statement);
+        stmt.condition_ = fold_(stmt.condition_);
+        if (is_literal(stmt.condition_) && !value_of(stmt.condition_).isTrue()) {
+            ++folded_;
+            return nullptr;
+        }
+        stmt.body_ = required_(stmt.body_);
+        return statement;
+    }
+    case AstNodeType::ForLoop: {
+        auto& stmt = *static_cast<Stmt::ForLoop*>(statement);
+        if (stmt.initializer_) {
+            stmt.initializer_ = optimize_(stmt.initializer_);
+        }
+        if (stmt.condition_) {
+            stmt.condition_ = fold_(stmt.condition_);
+        }
+        if (stmt.increment_) {
+            stmt.increment_ = optimize_(stmt.increment_);
+        }
+        stmt.body_ = required_(stmt.body_);
+        return statement;
+    }
+    case AstNodeType::Function:
+        optimize_(static_cast<Stmt::Function*>(statement)->body_);
+        return statement;
+    case AstNodeType::Klass:
+        for (const auto method : static_cast<Stmt::Klass*>(statement)->methods()) {
+            optimize_(method->body_);
+        }
+        return statement;
+    case AstNodeType::Return: {
+        auto& stmt = *static_cast<Stmt::Return*>(statement);
+        if (stmt.value_) {
+            stmt.value_ = fold_(stmt.value_);
+        }
+        return statement;
+    }
+    default:
+        return statement;
+    }
+}
+
+Stmt::Base::Ptr Optimizer::required_(const Stmt::Base::Ptr statement)
+{
+    const auto optimized = optimize_(statement);
+    return optimized ? optimized : program_.make<Stmt::Block>(std::vector<Stmt::Base::Ptr>{});
+}
+
+void Optimizer::optimize_(std::vector<Stmt::Base::Ptr>& statements)
+{
+    for (auto& statement : statements) {
+        statement = optimize_(statement);
+    }
+    statements.erase(std::remove(statements.begin(), statements.end(), nullptr), statements.end());
+}
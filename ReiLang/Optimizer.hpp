@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+
+#include "Ast.hpp"
+#include "Logger.hpp"
+#include "Program.hpp"
+
+//
+// Pass over the resolved ast that folds constants in place: operators over literals become literals,
+// groupings are dropped, and if/while statements with a constant condition lose their dead branch.
+// Whatever would fail at run time is left alone, so the error still shows up there with its line.
+//
+class Optimizer final
+{
+public:
+    Optimizer(Program& program, Logger& logger);
+    void optimize();
+private:
+    [[nodiscard]] Expr::Base::Ptr fold_(Expr::Base::Ptr expr);
+    [[nodiscard]] Expr::Base::Ptr fold_binary_(Expr::Binary& expr);
+    // a binary whose left operand is already folded
+    [[nodiscard]] Expr::Base::Ptr fold_operator_(Expr::Binary& expr);
+    [[nodiscard]] Expr::Base::Ptr fold_unary_(Expr::Unary& expr);
+    [[nodiscard]] Expr::Base::Ptr literal_(const Value& value);
+
+    // nullptr when nothing is left of the statement
+    [[nodiscard]] Stmt::Base::Ptr optimize_(Stmt::Base::Ptr statement);
+    // an empty block when nothing is left, for places that need a statement
+    [[nodiscard]] Stmt::Base::Ptr required_(Stmt::Base::Ptr statement);
+    void optimize_(std::vector<Stmt::Base::Ptr>& statements);
+
+    Program&     program_;
+    Logger&      logger_;
+    unsigned int folded_;
+};
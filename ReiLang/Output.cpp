@@ -0,0 +1,63 @@
+#include "Output.hpp"
+#include <cstring>
+
+Output::Output(std::ostream& out, const Mode mode) :
+    out_(out),
+    mode_(mode),
+    buffer_(capacity_),
+    used_(0)
+{
+}
+
+Output::~Output()
+{
+    flush();
+}
+
+void Output::print(const Value& value)
+{
+    switch (value.getType()) {
+    case ValueType::Number:
+        used_ += Value::formatNumber(value.getNumber(), reserve_(Value::number_chars));
+        break;
+    case ValueType::String:
+        write(value.getString());
+        break;
+    default:
+        write(value.toString());
+    }
+    *reserve_(1) = '\n';
+    ++used_;
+    if (mode_ == Mode::Line) {
+        flush();
+    }
+}
+
+void Output::write(const std::string_view text)
+{
+    if (text.size() > capacity_) {
+        flush();
+        out_.write(text.data(), static_cast<std::streamsize>(text.size()));
+        return;
+    }
+    std::memcpy(reserve_(text.size()), text.data(), text.size());
+    used_ += text.size();
+}
+
+void Output::flush()
+{
+    if (used_ > 0) {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(used_));
+        used_ = 0;
+    }
+    out_.flush();
+}
+
+char* Output::reserve_(const std::size_t size)
+{
+    if (used_ + size > capacity_) {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(used_));
+        used_ = 0;
+    }
+    return buffer_.data() + used_;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include "Value.hpp"
+
+//
+// Where print goes. Values are formatted straight into a byte buffer that is handed to the stream
+// when it fills up and when the interpreter is done, or after every line for interactive use.
+//
+class Output
+{
+public:
+    enum class Mode
+    {
+        Block, Line
+    };
+
+    explicit Output(std::ostream& out, Mode mode = Mode::Block);
+    Output(const Output&)              = delete;
+    Output& operator = (const Output&) = delete;
+    ~Output();
+
+    // the value and a newline
+    void print(const Value& value);
+    void write(std::string_view text);
+    void flush();
+private:
+    static constexpr std::size_t capacity_ = 64 * 1024;
+
+    // room for at least size more bytes
+    char* reserve_(std::size_t size);
+
+    std::ostream&     out_;
+    Mode              mode_;
+    std::vector<char> buffer_;
+    std::size_t       used_;
+};
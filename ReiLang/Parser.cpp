@@ -1,40 +1,42 @@
 #include "Parser.hpp"
 
-Parser::Parser(std::vector<std::shared_ptr<Token>> tokens, Logger& logger):
+Parser::Parser(Lexer& lexer, Logger& logger):
+    lexer_(lexer),
     current_(0),
-    tokens_(std::move(tokens)),
+    tokens_(lookahead_, lexer.next()),
     logger_(logger)
 {
 }
 
-std::vector<Stmt::Base::Ptr> Parser::parse()
+Program Parser::parse()
 {
-    std::vector<Stmt::Base::Ptr> statements;
     if (logger_.count(LogLevel::Fatal) > 0) {
         logger_.log(LogLevel::Info, "Parsing terminated due to fatal errors.");
-        return statements;
+        return std::move(program_);
     }
     while (!is_end_()) {
-        statements.push_back(declaration_());
+        program_.add(declaration_());
     }
     if (logger_.count(LogLevel::Error) > 0) {
         logger_.log(LogLevel::Fatal, "Bad parsing.");
     }
+    // lexing runs interleaved with parsing and is part of this
     logger_.elapse("Parsing");
-    return statements;
+    return std::move(program_);
 }
 
 Stmt::Base::Ptr Parser::declaration_()
 {
+    const unsigned int line = peek_().line;
     try {
         if (match_({ TokenType::Class })) {
-            return klass_declaration_();
+            return located_(klass_declaration_(), line);
         }
         if (match_({ TokenType::Fun })) {
-            return function_("function");
+            return located_(function_("function"), line);
         }
         if (match_({ TokenType::Var })) {
-            return var_declaration_();
+            return located_(var_declaration_(), line);
         }
         return statement_();
     } catch (const ParserException&) {
@@ -43,7 +45,7 @@ Stmt::Base::Ptr Parser::declaration_()
     }
 }
 
-Stmt::Base::Ptr Parser::function_(const std::string& kind)
+Stmt::Function* Parser::function_(const std::string& kind)
 {
     const Token name = consume_(TokenType::Identifier, "expect " + kind + " name.");
     consume_v_(TokenType::LeftParen, "expect '(' after " + kind + " name.");
@@ -59,7 +61,7 @@ Stmt::Base::Ptr Parser::function_(const std::string& kind)
     consume_v_(TokenType::RightParen, "expect ')' after parameters.");
     consume_v_(TokenType::LeftBrace, "expect '{' before " + kind + " body.");
     auto body = block_();
-    return std::make_shared<Stmt::Function>(name, params, body);
+    return make_<Stmt::Function>(name, params, body);
 }
 
 Stmt::Base::Ptr Parser::var_declaration_()
@@ -70,15 +72,21 @@ Stmt::Base::Ptr Parser::var_declaration_()
         init = expression_();
     }
     consume_v_(TokenType::Semicolon, "expect \';\' after variable declaration.");
-    return std::make_shared<Stmt::Var>(name, init);
+    return make_<Stmt::Var>(name, init);
 }
 
 Stmt::Base::Ptr Parser::statement_()
+{
+    const unsigned int line = peek_().line;
+    return located_(unlocated_statement_(), line);
+}
+
+Stmt::Base::Ptr Parser::unlocated_statement_()
 {
     if (match_({ TokenType::Break, TokenType::Continue })) {
         const Token controller = previous_();
         consume_v_(TokenType::Semicolon, "expect ';' after loop controller.");
-        return std::make_shared<Stmt::LoopControl>(controller);
+        return make_<Stmt::LoopControl>(controller);
     }
     if (match_({ TokenType::Return })) {
         return return_();
@@ -96,7 +104,7 @@ Stmt::Base::Ptr Parser::statement_()
         return print_stmt_();
     }
     if (match_({TokenType::LeftBrace})) {
-        return std::make_shared<Stmt::Block>(block_());
+        return make_<Stmt::Block>(block_());
     }
     return expression_stmt_();
 }
@@ -105,14 +113,14 @@ Stmt::Base::Ptr Parser::expression_stmt_()
 {
     auto expr = expression_();
     consume_v_(TokenType::Semicolon, "expect \';\' after expression.");
-    return std::make_shared<Stmt::Expression>(expr);
+    return make_<Stmt::Expression>(expr);
 }
 
 Stmt::Base::Ptr Parser::print_stmt_()
 {
     auto val = expression_();
     consume_v_(TokenType::Semicolon, "expect \';\' after value.");
-    return std::make_shared<Stmt::Print>(val);
+    return make_<Stmt::Print>(val);
 }
 
 Stmt::Base::Ptr Parser::if_statement_()
@@ -125,7 +133,7 @@ Stmt::Base::Ptr Parser::if_statement_()
     if (match_({ TokenType::Else })) {
         elseBranch = statement_();
     }
-    return std::make_shared<Stmt::IfStmt>(condition, thenBranch, elseBranch);
+    return make_<Stmt::IfStmt>(condition, thenBranch, elseBranch);
 }
 
 Stmt::Base::Ptr Parser::while_loop_()
@@ -134,11 +142,12 @@ Stmt::Base::Ptr Parser::while_loop_()
     const auto condition = expression_();
     consume_v_(TokenType::RightParen, "expect ')' after while condition.");
     const auto body = statement_();
-    return std::make_shared<Stmt::While>(condition, body);
+    return make_<Stmt::While>(condition, body);
 }
 
 Stmt::Base::Ptr Parser::for_loop_()
 {
+    const unsigned int line = previous_().line;
     consume_v_(TokenType::LeftParen, "expect '(' after 'for'.");
     Stmt::Base::Ptr init;
     if (match_({ TokenType::Semicolon })) {
@@ -155,15 +164,16 @@ Stmt::Base::Ptr Parser::for_loop_()
     }
     Stmt::Base::Ptr incr = nullptr;
     if (!match_({ TokenType::RightParen })) {
-        incr = std::make_shared<Stmt::Expression>(expression_());
+        const unsigned int incrLine = peek_().line;
+        incr = located_(make_<Stmt::Expression>(expression_()), incrLine);
         consume_v_(TokenType::RightParen, "expect ')' after for clauses.");
     }
-    std::shared_ptr<Stmt::Base> body = statement_();
+    Stmt::Base::Ptr body = statement_();
     if (!condition) {
-        condition = std::make_shared<Expr::Literal>(Value{ true });
+        condition = make_<Expr::Literal>(Value{ true });
     }
-    return std::make_shared<Stmt::Block>(std::list<Stmt::Base::Ptr>{
-        std::make_shared<Stmt::ForLoop>(init, condition, incr, body)
+    return make_<Stmt::Block>(std::vector<Stmt::Base::Ptr>{
+        located_(make_<Stmt::ForLoop>(init, condition, incr, body), line)
     });
 }
 
@@ -175,24 +185,24 @@ Stmt::Base::Ptr Parser::return_()
         value = expression_();
     }
     consume_v_(TokenType::Semicolon, "expect ';' after return value.");
-    return std::make_shared<Stmt::Return>(keyword, value);
+    return make_<Stmt::Return>(keyword, value);
 }
 
 Stmt::Base::Ptr Parser::klass_declaration_()
 {
     auto name = consume_(TokenType::Identifier, "expect class name.");
     consume_v_(TokenType::LeftBrace, "expect '{' before class body.");
-	std::vector<std::shared_ptr<Stmt::Function>> methods;
+	std::vector<Stmt::Function*> methods;
     while (!check_(TokenType::RightBrace) && !is_end_()) {
-        methods.push_back(std::dynamic_pointer_cast<Stmt::Function>(function_("method")));
+        methods.push_back(function_("method"));
     }
     consume_v_(TokenType::RightBrace, "expect '}' after class body.");
-    return std::make_shared<Stmt::Klass>(name, methods);
+    return make_<Stmt::Klass>(name, methods);
 }
 
-std::list<Stmt::Base::Ptr> Parser::block_()
+std::vector<Stmt::Base::Ptr> Parser::block_()
 {
-    std::list<Stmt::Base::Ptr> statements;
+    std::vector<Stmt::Base::Ptr> statements;
     while (!check_(TokenType::RightBrace) && !is_end_()) {
         statements.push_back(declaration_());
     }
@@ -212,12 +222,12 @@ Expr::Base::Ptr Parser::assignment_()
         const auto equals = previous_();
         auto val = assignment_();
         if (expr->type() == AstNodeType::Variable) {
-            Token name = dynamic_cast<Expr::Variable*>(expr.get())->name();
-            return std::make_shared<Expr::Assign>(name, val);
+            Token name = static_cast<Expr::Variable*>(expr)->name();
+            return make_<Expr::Assign>(name, val);
         }
     	if (expr->type() == AstNodeType::Get) {
-			auto get = dynamic_cast<Expr::Get*>(expr.get());
-			return std::make_shared<Expr::Set>(get->object(), get->name(), val);
+			auto get = static_cast<Expr::Get*>(expr);
+			return make_<Expr::Set>(get->object(), get->name(), val);
     	}
         throw error_(equals, "Invalid assignment target.");
     }
@@ -226,88 +236,80 @@ Expr::Base::Ptr Parser::assignment_()
 
 Expr::Base::Ptr Parser::ternary_()
 {
-    const auto cond = logic_or_();
+    const auto cond = binary_();
     if (match_({ TokenType::QuestionMark })) {
         auto ifTrue = ternary_();
         consume_v_(TokenType::Colon, "expect \':\' after ternary option.");
         auto ifFalse = ternary_();
-        return std::make_shared<Expr::Ternary>(cond, ifTrue, ifFalse);
+        return make_<Expr::Ternary>(cond, ifTrue, ifFalse);
     }
     return cond;
 }
 
-Expr::Base::Ptr Parser::logic_or_()
-{
-    auto expr = logic_and_();
-    while (match_({ TokenType::Or })) {
-        Token oper = previous_();
-        auto right = logic_and_();
-        expr = std::make_shared<Expr::Binary>(expr, oper, right);
-    }
-    return expr;
-}
+namespace {
 
-Expr::Base::Ptr Parser::logic_and_()
+// binding power of the left associative binary operators, 0 for anything else
+int precedence(const TokenType type)
 {
-    auto expr = equality_();
-    while (match_({ TokenType::And })) {
-        Token oper = previous_();
-        auto right = equality_();
-        expr = std::make_shared<Expr::Binary>(expr, oper, right);
+    switch (type) {
+    case TokenType::Or:           return 1;
+    case TokenType::And:          return 2;
+    case TokenType::EqualEqual:   [[fallthrough]] ;
+    case TokenType::BangEqual:    return 3;
+    case TokenType::Greater:      [[fallthrough]] ;
+    case TokenType::GreaterEqual: [[fallthrough]] ;
+    case TokenType::Less:         [[fallthrough]] ;
+    case TokenType::LessEqual:    return 4;
+    case TokenType::Plus:         [[fallthrough]] ;
+    case TokenType::Minus:        return 5;
+    case TokenType::Star:         [[fallthrough]] ;
+    case TokenType::Slash:        return 6;
+    default:                      return 0;
     }
-    return expr;
 }
 
-Expr::Base::Ptr Parser::equality_()
-{
-    auto expr = comparison_();
-    while (match_({TokenType::EqualEqual, TokenType::BangEqual})) {
-        Token oper = previous_();
-        auto right = comparison_();
-        expr = std::make_shared<Expr::Binary>(expr, oper, right);
-    }
-    return expr;
 }
 
-Expr::Base::Ptr Parser::comparison_()
+// Precedence climbing over explicit stacks instead of a call per level, so a chain of
+// thousands of terms costs no C++ recursion. The stacks are shared by nested expressions,
+// each call only touches what is above its own base.
+Expr::Base::Ptr Parser::binary_()
 {
-    auto expr = addition_();
-    while (match_({ TokenType::Greater, TokenType::GreaterEqual, TokenType::Less, TokenType::LessEqual })) {
-        Token oper = previous_();
-        auto right = addition_();
-        expr = std::make_shared<Expr::Binary>(expr, oper, right);
+    auto expr = unary_();
+    if (precedence(peek_().type) == 0) {
+        return expr;
+    }
+    const size_t base = operators_.size();
+    operands_.push_back(expr);
+    for (int prec = precedence(peek_().type); prec > 0; prec = precedence(peek_().type)) {
+        while (operators_.size() > base && precedence(operators_.back().type) >= prec) {
+            reduce_();
+        }
+        operators_.push_back(advance_());
+        operands_.push_back(unary_());
     }
-    return expr;
-}
-
-Expr::Base::Ptr Parser::addition_()
-{
-    auto expr = multiplication_();
-    while (match_({ TokenType::Plus, TokenType::Minus })) {
-        Token oper = previous_();
-        auto right = multiplication_();
-        expr = std::make_shared<Expr::Binary>(expr, oper, right);
+    while (operators_.size() > base) {
+        reduce_();
     }
+    expr = operands_.back();
+    operands_.pop_back();
     return expr;
 }
 
-Expr::Base::Ptr Parser::multiplication_()
+void Parser::reduce_()
 {
-    auto expr = unary_();
-    while (match_({ TokenType::Star, TokenType::Slash })) {
-        Token oper = previous_();
-        auto right = unary_();
-        expr = std::make_shared<Expr::Binary>(expr, oper, right);
-    }
-    return expr;
+    const auto right = operands_.back();
+    operands_.pop_back();
+    operands_.back() = make_<Expr::Binary>(operands_.back(), operators_.back(), right);
+    operators_.pop_back();
 }
 
 Expr::Base::Ptr Parser::unary_()
 {
-    if (match_({ TokenType::Minus, TokenType::Bang })) {
-        Token oper = previous_();
+    if (check_(TokenType::Minus) || check_(TokenType::Bang)) {
+        Token oper = advance_();
         auto operand = unary_();
-        return std::make_shared<Expr::Unary>(oper, operand);
+        return make_<Expr::Unary>(oper, operand);
     }
     return call_();
 }
@@ -316,11 +318,13 @@ Expr::Base::Ptr Parser::call_()
 {
     auto expr = primary_();
     while (true) {
-        if (match_({ TokenType::LeftParen })) {
+        if (check_(TokenType::LeftParen)) {
+            advance_v_();
             expr = finish_call_(expr);
-		} else if (match_({ TokenType::Dot })) {
+		} else if (check_(TokenType::Dot)) {
+            advance_v_();
 			auto name = consume_(TokenType::Identifier, "expect property name after '.'.");
-			expr = std::make_shared<Expr::Get>(expr, name);
+			expr = make_<Expr::Get>(expr, name);
 		} else {
             break;
         }
@@ -330,36 +334,39 @@ Expr::Base::Ptr Parser::call_()
 
 Expr::Base::Ptr Parser::primary_()
 {
-    if (match_({ TokenType::False })) {
-        return std::make_shared<Expr::Literal>(Value{ false });
-    }
-    if (match_({ TokenType::True })) {
-        return std::make_shared<Expr::Literal>(Value{ true });
-    }
-    if (match_({ TokenType::Nil })) {
-        return std::make_shared<Expr::Literal>(Value{});
-    }
-    if (match_({ TokenType::Number })) {
-        return std::make_shared<Expr::Literal>(Value{ std::get<double>(previous_().literal) });
-    }
-    if (match_({ TokenType::String })) {
-        return std::make_shared<Expr::Literal>(Value{ std::get<std::string>(previous_().literal) });
-    }
-    if (match_({ TokenType::LeftParen })) {
+    switch (peek_().type) {
+    case TokenType::False:
+        advance_v_();
+        return make_<Expr::Literal>(Value{ false });
+    case TokenType::True:
+        advance_v_();
+        return make_<Expr::Literal>(Value{ true });
+    case TokenType::Nil:
+        advance_v_();
+        return make_<Expr::Literal>(Value{});
+    case TokenType::Number:
+        return make_<Expr::Literal>(Value{ advance_().number });
+    case TokenType::String: {
+        const Value literal{ std::string{ advance_().literal() } };
+        Heap::current().pin(literal);
+        return make_<Expr::Literal>(literal);
+    }
+    case TokenType::LeftParen: {
+        advance_v_();
         auto expr = expression_();
         consume_v_(TokenType::RightParen, "expect ')' after expression.");
-        return std::make_shared<Expr::Grouping>(expr);
+        return make_<Expr::Grouping>(expr);
     }
-    if (match_({ TokenType::Identifier })) {
-        return std::make_shared<Expr::Variable>(previous_());
-    }
-	if (match_({ TokenType::This })) {
-		return std::make_shared<Expr::ThisKw>(previous_());
-	}
-    if (match_({ TokenType::Fun })) {
+    case TokenType::Identifier:
+        return make_<Expr::Variable>(advance_());
+	case TokenType::This:
+		return make_<Expr::ThisKw>(advance_());
+    case TokenType::Fun:
+        advance_v_();
         return lambda_();
+    default:
+        throw error_(peek_(), "expect expression.");
     }
-    throw error_(peek_(), "expect expression.");
 }
 
 // now, it's just a function_() copy. I'll do smth with it later
@@ -379,10 +386,10 @@ Expr::Base::Ptr Parser::lambda_()
     consume_v_(TokenType::RightParen, "expect ')' after parameters.");
     consume_v_(TokenType::LeftBrace, "expect '{' before lambda body.");
     auto body = block_();
-    return std::make_shared<Expr::Lambda>(params, body);
+    return make_<Expr::Lambda>(params, body);
 }
 
-Expr::Base::Ptr Parser::finish_call_(const Expr::Base::Ptr& callee)
+Expr::Base::Ptr Parser::finish_call_(Expr::Base::Ptr callee)
 {
     std::vector<Expr::Base::Ptr> args;
     if (!check_(TokenType::RightParen)) {
@@ -394,7 +401,7 @@ Expr::Base::Ptr Parser::finish_call_(const Expr::Base::Ptr& callee)
         throw error_(peek_(), "cannot have more than 255 arguments.");
     }
     Token paren = consume_(TokenType::RightParen, "expect ')' after arguments.");
-    return std::make_shared<Expr::Call>(callee, paren, args);
+    return make_<Expr::Call>(callee, paren, args);
 }
 
 bool Parser::match_(std::initializer_list<TokenType> lst)
@@ -421,25 +428,23 @@ bool Parser::is_end_() const
     return peek_().type == TokenType::Eof;
 }
 
-Token Parser::peek_() const
+const Token& Parser::peek_() const
 {
-    return *tokens_[current_];
+    return tokens_[current_ % lookahead_];
 }
 
-Token Parser::previous_() const
+const Token& Parser::previous_() const
 {
-    return *tokens_[current_ - 1];
+    return tokens_[(current_ - 1) % lookahead_];
 }
 
-Token Parser::advance_()
+const Token& Parser::advance_()
 {
-    if (!is_end_()) {
-        ++current_;
-    }
+    advance_v_();
     return previous_();
 }
 
-Token Parser::consume_(const TokenType type, const std::string& msg)
+const Token& Parser::consume_(const TokenType type, const std::string& msg)
 {
     if (check_(type)) {
         return advance_();
@@ -451,6 +456,7 @@ void Parser::advance_v_()
 {
     if (!is_end_()) {
         current_++;
+        tokens_[current_ % lookahead_] = lexer_.next();
     }
 }
 
@@ -465,7 +471,7 @@ void Parser::consume_v_(const TokenType type, const std::string& msg)
 
 Parser::ParserException Parser::error_(const Token& token, const std::string& msg) const
 {
-    logger_.log(LogLevel::Error, token.line, "At token \'" + token.lexeme + "\' " + msg);
+    logger_.log(LogLevel::Error, token.line, "At token \'" + std::string{ token.lexeme } + "\' " + msg);
     return ParserException{};
 }
 
@@ -4,12 +4,16 @@
 
 #include "Lexer.hpp"
 #include "Ast.hpp"
+#include "Heap.hpp"
+#include "Program.hpp"
 
 class Parser
 {
 public:
-    Parser(std::vector<std::shared_ptr<Token>> tokens, Logger& logger);
-    std::vector<Stmt::Base::Ptr> parse();
+    // tokens are pulled from the lexer as the parser goes, only the last few are kept
+    Parser(Lexer& lexer, Logger& logger);
+    // the parser is left empty, the program owns every node
+    Program parse();
 private:
 
     class ParserException : std::exception
@@ -18,9 +22,10 @@ private:
     };
 
     Stmt::Base::Ptr declaration_();
-    Stmt::Base::Ptr function_(const std::string& kind);
+    Stmt::Function* function_(const std::string& kind);
     Stmt::Base::Ptr var_declaration_();
     Stmt::Base::Ptr statement_();
+    Stmt::Base::Ptr unlocated_statement_();
     Stmt::Base::Ptr expression_stmt_();
     Stmt::Base::Ptr print_stmt_();
     Stmt::Base::Ptr if_statement_();
@@ -30,40 +35,50 @@ private:
     Stmt::Base::Ptr klass_declaration_();
 
 
-    std::list<Stmt::Base::Ptr> block_();
+    std::vector<Stmt::Base::Ptr> block_();
 
 
     Expr::Base::Ptr expression_();
     Expr::Base::Ptr assignment_();
     Expr::Base::Ptr ternary_();
-    Expr::Base::Ptr logic_or_();
-    Expr::Base::Ptr logic_and_();
-    Expr::Base::Ptr equality_();
-    Expr::Base::Ptr comparison_();
-    Expr::Base::Ptr addition_();
-    Expr::Base::Ptr multiplication_();
+    Expr::Base::Ptr binary_();
+    void            reduce_();
     Expr::Base::Ptr unary_();
     Expr::Base::Ptr call_();
     Expr::Base::Ptr primary_();
     Expr::Base::Ptr lambda_();
 
-    Expr::Base::Ptr finish_call_(const Expr::Base::Ptr& callee);
+    Expr::Base::Ptr finish_call_(Expr::Base::Ptr callee);
 
     bool match_(std::initializer_list<TokenType> lst);
-    [[nodiscard]] bool  check_(TokenType expected) const;
-    [[nodiscard]] bool  is_end_()                  const;
-    [[nodiscard]] Token peek_()                    const;
-    [[nodiscard]] Token previous_()                const;
+    [[nodiscard]] bool         check_(TokenType expected) const;
+    [[nodiscard]] bool         is_end_()                  const;
+    [[nodiscard]] const Token& peek_()                    const;
+    [[nodiscard]] const Token& previous_()                const;
 
-    Token advance_();
-    Token consume_(TokenType type, const std::string& msg);
+    const Token& advance_();
+    const Token& consume_(TokenType type, const std::string& msg);
     void advance_v_();
     void consume_v_(TokenType type, const std::string& msg);
 
+    template <typename T, typename... Args>
+    T* make_(Args&&... args) { return program_.make<T>(std::forward<Args>(args)...); }
+    // the line a statement starts on, for runtime tools such as the profiler
+    template <typename T>
+    T* located_(T* stmt, const unsigned int line) { stmt->locate(line); return stmt; }
+
     [[nodiscard]] ParserException error_(const Token& token, const std::string& msg) const;
     void synchronize_();
 
-    size_t                              current_;
-    std::vector<std::shared_ptr<Token>> tokens_;
-    Logger&                             logger_;
+    // a power of two, enough for previous_ and peek_ with room for the references they hand out
+    static constexpr size_t lookahead_ = 4;
+
+    Lexer&             lexer_;
+    size_t             current_;
+    std::vector<Token> tokens_;     // ring indexed by current_
+    Logger&            logger_;
+    Program            program_;
+
+    std::vector<Expr::Base::Ptr> operands_;     // binary_ stacks
+    std::vector<Token>           operators_;
 };
@@ -0,0 +1,135 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <iomanip>
+
+Profiler::Profiler(const std::chrono::microseconds interval) :
+    interval_(interval),
+    due_(false),
+    stopping_(false),
+    dropped_(0),
+    samples_(0)
+{
+}
+
+Profiler::~Profiler()
+{
+    stop();
+}
+
+void Profiler::start()
+{
+    if (!watchdog_.joinable()) {
+        stopping_.store(false, std::memory_order_relaxed);
+        watchdog_ = std::thread{ &Profiler::watch_, this };
+    }
+}
+
+void Profiler::stop()
+{
+    if (watchdog_.joinable()) {
+        stopping_.store(true, std::memory_order_release);
+        watchdog_.join();
+    }
+    due_.store(false, std::memory_order_relaxed);
+}
+
+std::uint32_t Profiler::intern(const std::string_view function)
+{
+    const auto id = ids_.find(function);
+    if (id != ids_.end()) {
+        return id->second;
+    }
+    const auto next = static_cast<std::uint32_t>(names_.size());
+    names_.emplace_back(function);
+    ids_.emplace(function, next);
+    return next;
+}
+
+void Profiler::sample(const Frame* frames, std::size_t depth)
+{
+    due_.store(false, std::memory_order_relaxed);
+    Sample sample;
+    sample.truncated = depth > max_depth_;
+    if (sample.truncated) {
+        frames += depth - max_depth_;
+        depth = max_depth_;
+    }
+    sample.depth = static_cast<std::uint16_t>(depth);
+    std::copy(frames, frames + depth, sample.frames);
+    if (!ring_.tryPush(sample)) {
+        ++dropped_;
+    }
+}
+
+void Profiler::watch_()
+{
+    Sample sample;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(interval_);
+        due_.store(true, std::memory_order_relaxed);
+        while (ring_.tryPop(sample)) {
+            tally_(sample);
+        }
+    }
+    while (ring_.tryPop(sample)) {
+        tally_(sample);
+    }
+}
+
+void Profiler::tally_(const Sample& sample)
+{
+    if (sample.depth == 0) {
+        return;
+    }
+    ++samples_;
+    std::vector<std::uint32_t> stack;
+    stack.reserve(sample.depth + 1);
+    if (sample.truncated) {
+        stack.push_back(~0u);
+    }
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> seen;
+    seen.reserve(sample.depth);
+    for (std::size_t i = 0; i < sample.depth; i++) {
+        const Frame& frame = sample.frames[i];
+        stack.push_back(frame.function);
+        seen.emplace_back(frame.function, frame.line);
+    }
+    ++stacks_[stack];
+    const Frame& top = sample.frames[sample.depth - 1];
+    ++lines_[{ top.function, top.line }].self;
+    // a recursive function counts once per sample towards the total of a line
+    std::sort(seen.begin(), seen.end());
+    seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+    for (const auto& line : seen) {
+        ++lines_[line].total;
+    }
+}
+
+void Profiler::writeFolded(std::ostream& out) const
+{
+    for (const auto& [stack, count] : stacks_) {
+        for (std::size_t i = 0; i < stack.size(); i++) {
+            out << (i > 0 ? ";" : "") << (stack[i] == ~0u ? "[truncated]" : names_[stack[i]]);
+        }
+        out << " " << count << "\n";
+    }
+}
+
+void Profiler::writeLines(std::ostream& out) const
+{
+    std::vector<std::pair<std::pair<std::uint32_t, std::uint32_t>, LineStat>> lines{ lines_.begin(), lines_.end() };
+    std::sort(lines.begin(), lines.end(), [](const auto& l, const auto& r) {
+        return l.second.self != r.second.self ? l.second.self > r.second.self : l.second.total > r.second.total;
+    });
+    const double interval = std::chrono::duration<double, std::milli>{ interval_ }.count();
+    const auto percent = [this](const std::size_t count) { return samples_ > 0 ? 100.0 * count / samples_ : 0.0; };
+    out << samples_ << " samples every " << interval << " ms, " << dropped_ << " dropped\n";
+    out << std::setw(9) << "self %" << std::setw(9) << "total %" << std::setw(11) << "self ms" << std::setw(11) << "total ms"
+        << "  function:line\n";
+    out << std::fixed << std::setprecision(2);
+    for (const auto& [location, stat] : lines) {
+        out << std::setw(9) << percent(stat.self) << std::setw(9) << percent(stat.total)
+            << std::setw(11) << stat.self * interval << std::setw(11) << stat.total * interval
+            << "  " << names_[location.first] << ":" << location.second << "\n";
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "LogRing.hpp"
+#include "StringHash.hpp"
+
+//
+// Sampling profiler of Lox code. A watchdog thread raises a flag every interval; the interpreter checks it
+// at safe points (statements of the tree-walker, calls and backward jumps of the bytecode engine) and copies
+// its call stack into a lock-free ring, which the watchdog drains and tallies by stack and by source line.
+//
+class Profiler
+{
+public:
+    struct Frame
+    {
+        std::uint32_t function;
+        std::uint32_t line;
+    };
+
+    explicit Profiler(std::chrono::microseconds interval);
+    Profiler(const Profiler&)              = delete;
+    Profiler& operator = (const Profiler&) = delete;
+    ~Profiler();
+
+    void start();
+    // the tallies may only be read once stopped
+    void stop();
+
+    // everything below is called from the interpreter thread
+
+    [[nodiscard]] bool due() const { return due_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::uint32_t intern(std::string_view function);
+    // frames go from the outermost call to the innermost
+    void sample(const Frame* frames, std::size_t depth);
+
+    // the tree-walker keeps its call stack here
+    void enter(std::string_view function) { stack_.push_back({ intern(function), 0 }); }
+    void leave() { stack_.pop_back(); }
+    // statements the parser did not write keep the line of the last one
+    void at(const unsigned int line)
+    {
+        if (line > 0) {
+            stack_.back().line = line;
+        }
+        if (due()) {
+            sample(stack_.data(), stack_.size());
+        }
+    }
+
+    // one line per distinct stack: the functions from the outermost joined by ';', a space, the sample count
+    void writeFolded(std::ostream& out) const;
+    // self and total share of the samples per function and line
+    void writeLines(std::ostream& out) const;
+    [[nodiscard]] std::size_t samples() const { return samples_; }
+private:
+    static constexpr std::size_t max_depth_ = 64;
+
+    // the innermost frames of a deeper stack, marked as truncated
+    struct Sample
+    {
+        std::uint16_t depth;
+        bool          truncated;
+        Frame         frames[max_depth_];
+    };
+
+    struct LineStat
+    {
+        std::size_t self  = 0;
+        std::size_t total = 0;
+    };
+
+    // body of the watchdog thread
+    void watch_();
+    void tally_(const Sample& sample);
+
+    std::chrono::microseconds            interval_;
+    std::atomic<bool>                    due_;
+    std::atomic<bool>                    stopping_;
+    std::thread                          watchdog_;
+    LogRing<Sample, 64>                  ring_;
+
+    // interpreter thread
+    StringMap<std::uint32_t>             ids_;
+    std::vector<std::string>             names_;
+    std::vector<Frame>                   stack_;
+    std::size_t                          dropped_;
+
+    // watchdog thread until stopped
+    std::size_t                                                      samples_;
+    std::map<std::vector<std::uint32_t>, std::size_t>                stacks_;
+    std::map<std::pair<std::uint32_t, std::uint32_t>, LineStat>      lines_;
+};
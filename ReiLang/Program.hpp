@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+
+#include "Arena.hpp"
+#include "Ast.hpp"
+
+//
+// Parsed script: top-level statements and the arena that owns every node of their trees.
+// Nodes refer to each other by raw pointers and stay valid as long as the program does.
+//
+class Program
+{
+public:
+    Program() = default;
+
+    Program(const Program&)              = delete;
+    Program& operator = (const Program&) = delete;
+    Program(Program&&)                   = default;
+    Program& operator = (Program&&)      = default;
+    ~Program()                           = default;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) { return arena_.make<T>(std::forward<Args>(args)...); }
+    void add(Stmt::Base::Ptr statement) { statements_.push_back(statement); }
+
+    [[nodiscard]] const std::vector<Stmt::Base::Ptr>& statements() const { return statements_; }
+    [[nodiscard]] std::vector<Stmt::Base::Ptr>&       statements()       { return statements_; }
+    [[nodiscard]] const Arena&                        arena()      const { return arena_;      }
+private:
+    Arena                        arena_;
+    std::vector<Stmt::Base::Ptr> statements_;
+};
@@ -0,0 +1,70 @@
+#include "Random.hpp"
+#include <cmath>
+
+namespace {
+
+std::uint64_t rotl(const std::uint64_t x, const int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+// spreads a seed over the generator state, as recommended by the xoshiro authors
+std::uint64_t splitmix64(std::uint64_t& x)
+{
+    std::uint64_t z = (x += 0x9e3779b97f4a7c15u);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+}
+
+Random::Random(const std::uint64_t seed) :
+    state_{},
+    block_{},
+    used_(block_size)
+{
+    this->seed(seed);
+}
+
+void Random::seed(std::uint64_t seed)
+{
+    for (auto& word : state_) {
+        word = splitmix64(seed);
+    }
+    used_ = block_.size();
+}
+
+std::uint64_t Random::next()
+{
+    const std::uint64_t result = rotl(state_[1] * 5, 7) * 9;
+    const std::uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = rotl(state_[3], 45);
+    return result;
+}
+
+void Random::fill(double* out, const std::size_t count)
+{
+    // the top 53 bits make an exact double in [0, 1)
+    for (std::size_t i = 0; i < count; i++) {
+        out[i] = static_cast<double>(next() >> 11) * 0x1.0p-53;
+    }
+}
+
+double Random::between(const double low, const double high)
+{
+    const double from = std::floor(low);
+    const double span = std::ceil(high) - from + 1;
+    return from + std::floor(uniform() * span);
+}
+
+void Random::refill_()
+{
+    fill(block_.data(), block_.size());
+    used_ = 0;
+}
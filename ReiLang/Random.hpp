@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+//
+// xoshiro256** generator of an interpreter, so seeding it makes a run reproducible.
+// Single numbers are handed out from a block that is filled in bulk.
+//
+class Random
+{
+public:
+    static constexpr std::size_t block_size = 256;
+
+    explicit Random(std::uint64_t seed);
+    // restarts the sequence, dropping what is left of the block
+    void seed(std::uint64_t seed);
+
+    [[nodiscard]] std::uint64_t next();
+    // count numbers uniform in [0, 1)
+    void fill(double* out, std::size_t count);
+
+    // uniform in [0, 1)
+    [[nodiscard]] double uniform()
+    {
+        if (used_ == block_.size()) {
+            refill_();
+        }
+        return block_[used_++];
+    }
+    // uniform whole number in [low, high]
+    [[nodiscard]] double between(double low, double high);
+private:
+    void refill_();
+
+    std::array<std::uint64_t, 4>   state_;
+    std::array<double, block_size> block_;
+    std::size_t                    used_;
+};
@@ -1,7 +1,6 @@
 #include "Resolver.hpp"
 
-Resolver::Resolver(Interpreter& interpreter, Logger& logger):
-    interpreter_(interpreter),
+Resolver::Resolver(Logger& logger):
     logger_(logger),
     current_fun_(FunType::None),
     is_loop_(false)
@@ -22,10 +21,19 @@ Value Resolver::visitTernary(Expr::Ternary& expr)
     return {};
 }
 
+// the left spine of a + b + c ... with a loop, left operands before right ones as the interpreter evaluates them
 Value Resolver::visitBinary(Expr::Binary& expr)
 {
-    resolve_(expr.left());
-    resolve_(expr.right());
+    std::vector<Expr::Binary*> chain;
+    Expr::Base::Ptr left = &expr;
+    while (left->type() == AstNodeType::Binary) {
+        chain.push_back(static_cast<Expr::Binary*>(left));
+        left = chain.back()->left();
+    }
+    resolve_(left);
+    for (auto node = chain.rbegin(); node != chain.rend(); ++node) {
+        resolve_((*node)->right());
+    }
     return {};
 }
 
@@ -42,17 +50,17 @@ Value Resolver::visitLiteral(Expr::Literal&)
 
 Value Resolver::visitVariable(Expr::Variable& expr)
 {
-    if (!scopes_.empty() && scopes_.back().find(expr.name().lexeme) != scopes_.back().end() && !scopes_.back().at(expr.name().lexeme)) {
+    if (!scopes_.empty() && scopes_.back().find(expr.name().lexeme) != scopes_.back().end() && !scopes_.back().at(expr.name().lexeme).defined) {
         logger_.log(LogLevel::Error, expr.name().line, "Cannot read local variable in its own initializer.");
     }
-    resolve_local_(&expr, expr.name());
+    expr.resolve(resolve_local_(expr.name()));
     return {};
 }
 
 Value Resolver::visitAssign(Expr::Assign& expr)
 {
     resolve_(expr.value());
-    resolve_local_(&expr, expr.name());
+    expr.resolve(resolve_local_(expr.name()));
     return {};
 }
 
@@ -67,6 +75,7 @@ Value Resolver::visitCall(Expr::Call& expr)
 
 Value Resolver::visitLambda(Expr::Lambda* expr)
 {
+    capture_scopes_();
     const auto enclosing = current_fun_;
     current_fun_ = FunType::Lambda;
     begin_scope_();
@@ -75,7 +84,9 @@ Value Resolver::visitLambda(Expr::Lambda* expr)
         define_(p);
     }
     resolve_(expr->body());
-    end_scope_();
+    if (end_scope_()) {
+        expr->capture();
+    }
     current_fun_ = enclosing;
     return {};
 }
@@ -95,62 +106,71 @@ Value Resolver::visitSet(Expr::Set& expr)
 
 Value Resolver::visitThis(Expr::ThisKw& expr)
 {
-	resolve_local_(&expr, expr.keyword());
+	expr.resolve(resolve_local_(expr.keyword()));
 	return {};
 }
 
-void Resolver::visitExpression(Stmt::Expression& stmt)
+Completion Resolver::visitExpression(Stmt::Expression& stmt)
 {
     resolve_(stmt.expr());
+    return {};
 }
 
-void Resolver::visitPrint(Stmt::Print& stmt)
+Completion Resolver::visitPrint(Stmt::Print& stmt)
 {
     resolve_(stmt.expr());
+    return {};
 }
 
-void Resolver::visitVar(Stmt::Var& stmt)
+Completion Resolver::visitVar(Stmt::Var& stmt)
 {
-    declare_(stmt.var());
+    stmt.resolve(declare_(stmt.var()));
     if (stmt.expr()) {
         resolve_(stmt.expr());
     }
     define_(stmt.var());
+    return {};
 }
 
-void Resolver::visitBlock(Stmt::Block& stmt)
+Completion Resolver::visitBlock(Stmt::Block& stmt)
 {
     begin_scope_();
     resolve_(stmt.statements());
-    end_scope_();
+    if (end_scope_()) {
+        stmt.capture();
+    }
+    return {};
 }
 
-void Resolver::visitIfStmt(Stmt::IfStmt& stmt)
+Completion Resolver::visitIfStmt(Stmt::IfStmt& stmt)
 {
     resolve_(stmt.condition());
     resolve_(stmt.thenBranch());
     if (stmt.elseBranch()) {
         resolve_(stmt.elseBranch());
     }
+    return {};
 }
 
-void Resolver::visitWhile(Stmt::While& stmt)
+Completion Resolver::visitWhile(Stmt::While& stmt)
 {
     const bool old = is_loop_;
     is_loop_ = true;
     resolve_(stmt.condition());
     resolve_(stmt.body());
     is_loop_ = old;
+    return {};
 }
 
-void Resolver::visitControl(Stmt::LoopControl& stmt)
+Completion Resolver::visitControl(Stmt::LoopControl& stmt)
 {
     if (!is_loop_) {
         logger_.log(LogLevel::Error, stmt.controller().line, "Loop controller outside loop.");
     }
+    return {};
 }
 
-void Resolver::visitForLoop(Stmt::ForLoop& stmt)
+Completion Resolver::visitForLoop(Stmt::ForLoop& stmt)
 {
     const bool old = is_loop_;
     is_loop_ = true;
@@ -159,34 +179,37 @@ void Resolver::visitForLoop(Stmt::ForLoop& stmt)
     resolve_(stmt.increment());
     resolve_(stmt.body());
     is_loop_ = old;
+    return {};
 }
 
-void Resolver::visitFunction(Stmt::Function* stmt)
+Completion Resolver::visitFunction(Stmt::Function* stmt)
 {
-    declare_(stmt->name());
+    capture_scopes_();
+    stmt->resolve(declare_(stmt->name()));
     define_(stmt->name());
     resolve_function_(stmt, FunType::Function);
+    return {};
 }
 
-void Resolver::visitReturn(Stmt::Return& stmt)
+Completion Resolver::visitReturn(Stmt::Return& stmt)
 {
     if (current_fun_ == FunType::None) {
         logger_.log(LogLevel::Error, stmt.keyword().line, "Return statement outside function.");
     } else if (stmt.value()) {
         resolve_(stmt.value());
     }
+    return {};
 }
 
-void Resolver::visitKlass(Stmt::Klass& stmt)
+Completion Resolver::visitKlass(Stmt::Klass& stmt)
 {
-    declare_(stmt.name());
+    capture_scopes_();
+    stmt.resolve(declare_(stmt.name()));
     define_(stmt.name());
-	begin_scope_();
-	scopes_.back().insert({ "this", true });
 	for (auto& m : stmt.methods()) {
-		resolve_function_(m.get(), FunType::Method);
+		resolve_function_(m, FunType::Method);
 	}
-	end_scope_();
+	return {};
 }
 
 void Resolver::resolve(const std::vector<Stmt::Base::Ptr>& statements)
@@ -209,31 +232,25 @@ void Resolver::resolve_(const std::vector<Stmt::Base::Ptr>& statements)
     }
 }
 
-void Resolver::resolve_(const std::list<Stmt::Base::Ptr>& statements)
+void Resolver::resolve_(Stmt::Base::Ptr statement)
 {
-    for (auto& s : statements) {
-        resolve_(s);
-    }
+    (void)statement->accept(*this);
 }
 
-void Resolver::resolve_(const Stmt::Base::Ptr& statement)
-{
-    statement->accept(*this);
-}
-
-void Resolver::resolve_(const Expr::Base::Ptr& expression)
+void Resolver::resolve_(Expr::Base::Ptr expression)
 {
     (void)expression->accept(*this);
 }
 
-void Resolver::resolve_local_(Expr::Base* expr, const Token& token)
+VarSlot Resolver::resolve_local_(const Token& token) const
 {
     for (int i = scopes_.size() - 1; i >= 0; i--) {
-        if (scopes_[i].find(token.lexeme) != scopes_[i].end()) {
-            interpreter_.resolve(expr, scopes_.size() - 1 - i);
-            return;
+        const auto local = scopes_[i].find(token.lexeme);
+        if (local != scopes_[i].end()) {
+            return { static_cast<unsigned>(scopes_.size() - 1 - i), local->second.slot };
         }
     }
+    return {};
 }
 
 void Resolver::resolve_function_(Stmt::Function* fun, FunType type)
@@ -241,25 +258,34 @@ void Resolver::resolve_function_(Stmt::Function* fun, FunType type)
     const auto enclosing = current_fun_;
     current_fun_ = type;
     begin_scope_();
+    // the receiver of a method is passed in the first slot of its own scope
+    if (type == FunType::Method) {
+        scopes_.back().insert({ "this", { true, 0 } });
+    }
     for (auto& p : fun->params()) {
         declare_(p);
         define_(p);
     }
     resolve_(fun->body());
-    end_scope_();
+    if (end_scope_()) {
+        fun->capture();
+    }
     current_fun_ = enclosing;
-
 }
 
-void Resolver::declare_(const Token& token)
+VarSlot Resolver::declare_(const Token& token)
 {
     if (scopes_.empty()) {
-        return;
+        return {};
     }
-    if (scopes_.back().find(token.lexeme) != scopes_.back().end()) {
-        logger_.log(LogLevel::Error, token.line, "Variable '" + token.lexeme + "' already declared in this scope.");
+    auto& scope = scopes_.back();
+    if (scope.find(token.lexeme) != scope.end()) {
+        logger_.log(LogLevel::Error, token.line, "Variable '" + std::string{ token.lexeme } + "' already declared in this scope.");
+        return { 0, scope.at(token.lexeme).slot };
     }
-    scopes_.back().insert({ token.lexeme, false });
+    const unsigned slot = scope.size();
+    scope.insert({ token.lexeme, { false, slot } });
+    return { 0, slot };
 }
 
 void Resolver::define_(const Token& token)
@@ -267,15 +293,24 @@ void Resolver::define_(const Token& token)
     if (scopes_.empty()) {
         return;
     }
-    scopes_.back()[token.lexeme] = true;
+    scopes_.back()[token.lexeme].defined = true;
 }
 
 void Resolver::begin_scope_()
 {
     scopes_.emplace_back();
+    captured_.push_back(false);
 }
 
-void Resolver::end_scope_()
+bool Resolver::end_scope_()
 {
+    const bool captured = captured_.back();
     scopes_.pop_back();
+    captured_.pop_back();
+    return captured;
+}
+
+void Resolver::capture_scopes_()
+{
+    captured_.assign(captured_.size(), true);
 }
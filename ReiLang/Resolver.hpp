@@ -1,10 +1,14 @@
 #pragma once
-#include "Interpreter.hpp"
+#include <map>
+#include <string_view>
+#include <vector>
+#include "Ast.hpp"
+#include "Logger.hpp"
 
 class Resolver : public Expr::Visitor, public Stmt::Visitor
 {
 public:
-    Resolver(Interpreter& interpreter, Logger& logger);
+    explicit Resolver(Logger& logger);
     Value visitGrouping(Expr::Grouping&) override;
     Value visitTernary(Expr::Ternary&)   override;
     Value visitBinary(Expr::Binary&)     override;
@@ -18,17 +22,17 @@ public:
 	Value visitSet(Expr::Set&)           override;
 	Value visitThis(Expr::ThisKw&)       override;
 
-    void visitExpression(Stmt::Expression&) override;
-    void visitPrint(Stmt::Print&)           override;
-    void visitVar(Stmt::Var&)               override;
-    void visitBlock(Stmt::Block&)           override;
-    void visitIfStmt(Stmt::IfStmt&)         override;
-    void visitWhile(Stmt::While&)           override;
-    void visitControl(Stmt::LoopControl&)   override;
-    void visitForLoop(Stmt::ForLoop&)       override;
-    void visitFunction(Stmt::Function*)     override;
-    void visitReturn(Stmt::Return&)         override;
-    void visitKlass(Stmt::Klass&)           override;
+    Completion visitExpression(Stmt::Expression&) override;
+    Completion visitPrint(Stmt::Print&)           override;
+    Completion visitVar(Stmt::Var&)               override;
+    Completion visitBlock(Stmt::Block&)           override;
+    Completion visitIfStmt(Stmt::IfStmt&)         override;
+    Completion visitWhile(Stmt::While&)           override;
+    Completion visitControl(Stmt::LoopControl&)   override;
+    Completion visitForLoop(Stmt::ForLoop&)       override;
+    Completion visitFunction(Stmt::Function*)     override;
+    Completion visitReturn(Stmt::Return&)         override;
+    Completion visitKlass(Stmt::Klass&)           override;
 
     void resolve(const std::vector<Stmt::Base::Ptr>& statements);
 private:
@@ -38,21 +42,29 @@ private:
         None, Function, Lambda, Method
     };
 
+    struct Local
+    {
+        bool     defined;
+        unsigned slot;
+    };
+
     void resolve_(const std::vector<Stmt::Base::Ptr>& statements);
-    void resolve_(const std::list<Stmt::Base::Ptr>& statements);
-    void resolve_(const Stmt::Base::Ptr& statement);
-    void resolve_(const Expr::Base::Ptr& expression);
-    void resolve_local_(Expr::Base* expr, const Token& token);
+    void resolve_(Stmt::Base::Ptr statement);
+    void resolve_(Expr::Base::Ptr expression);
+    [[nodiscard]] VarSlot resolve_local_(const Token& token) const;
     void resolve_function_(Stmt::Function* fun, FunType type);
-    void declare_(const Token& token);
+    VarSlot declare_(const Token& token);
     void define_(const Token& token);
     void begin_scope_();
-    void end_scope_();
+    // true when a closure has been created inside the scope
+    bool end_scope_();
+    // every enclosing scope may outlive its block or call once a closure holds on to it
+    void capture_scopes_();
 
-    Interpreter&                             interpreter_;
-    Logger&                                  logger_;
-    std::vector<std::map<std::string, bool>> scopes_;
-    FunType                                  current_fun_;
-    bool                                     is_loop_;
+    Logger&                                        logger_;
+    std::vector<std::map<std::string_view, Local>> scopes_;
+    std::vector<bool>                              captured_;
+    FunType                                        current_fun_;
+    bool                                           is_loop_;
 };
 
@@ -0,0 +1,154 @@
+#include "Scan.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define REI_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+
+bool is_blank(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool is_word(const char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+#ifdef REI_SSE2
+
+constexpr size_t block_size = 16;
+
+__m128i load(const char* text, const size_t pos)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+}
+
+unsigned int mask(const __m128i bytes)
+{
+    return static_cast<unsigned int>(_mm_movemask_epi8(bytes));
+}
+
+unsigned int first_bit(const unsigned int bits)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return index;
+#else
+    return static_cast<unsigned int>(__builtin_ctz(bits));
+#endif
+}
+
+// newlines are rare, so clearing the lowest bit beats a table
+unsigned int bit_count(unsigned int bits)
+{
+    unsigned int count = 0;
+    for (; bits; bits &= bits - 1) {
+        ++count;
+    }
+    return count;
+}
+
+// lo <= byte <= hi for ascii bounds, bytes above 0x7f are negative and never match
+__m128i in_range(const __m128i bytes, const char lo, const char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmplt_epi8(bytes, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+// stops at the first set bit of found, newlines are counted up to it
+size_t advance(const unsigned int found, const unsigned int newlines, const size_t pos, unsigned int& lines)
+{
+    const unsigned int end = first_bit(found);
+    lines += bit_count(newlines & ((1u << end) - 1));
+    return pos + end;
+}
+
+#endif
+
+}
+
+size_t scan::scalar::blanks(const char* text, const size_t size, size_t pos, unsigned int& lines)
+{
+    for (; pos < size && is_blank(text[pos]); pos++) {
+        lines += text[pos] == '\n';
+    }
+    return pos;
+}
+
+size_t scan::scalar::identifier(const char* text, const size_t size, size_t pos)
+{
+    while (pos < size && is_word(text[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t scan::scalar::until(const char* text, const size_t size, size_t pos, const char stop, unsigned int& lines)
+{
+    for (; pos < size && text[pos] != stop; pos++) {
+        lines += text[pos] == '\n';
+    }
+    return pos;
+}
+
+size_t scan::simd::blanks(const char* text, const size_t size, size_t pos, unsigned int& lines)
+{
+#ifdef REI_SSE2
+    // most blanks are a single space between tokens, not worth a block
+    if (pos < size && !is_blank(text[pos])) {
+        return pos;
+    }
+    for (; pos + block_size <= size; pos += block_size) {
+        const __m128i bytes   = load(text, pos);
+        const __m128i newline = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'));
+        const __m128i blank   = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+                                             _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r')), newline));
+        const unsigned int other = ~mask(blank) & 0xFFFF;
+        if (other) {
+            return advance(other, mask(newline), pos, lines);
+        }
+        lines += bit_count(mask(newline));
+    }
+#endif
+    return scalar::blanks(text, size, pos, lines);
+}
+
+size_t scan::simd::identifier(const char* text, const size_t size, size_t pos)
+{
+#ifdef REI_SSE2
+    for (; pos + block_size <= size; pos += block_size) {
+        const __m128i bytes = load(text, pos);
+        const __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+        const __m128i word  = _mm_or_si128(_mm_or_si128(in_range(lower, 'a', 'z'), in_range(bytes, '0', '9')),
+                                           _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_')));
+        const unsigned int other = ~mask(word) & 0xFFFF;
+        if (other) {
+            return pos + first_bit(other);
+        }
+    }
+#endif
+    return scalar::identifier(text, size, pos);
+}
+
+size_t scan::simd::until(const char* text, const size_t size, size_t pos, const char stop, unsigned int& lines)
+{
+#ifdef REI_SSE2
+    for (; pos + block_size <= size; pos += block_size) {
+        const __m128i bytes   = load(text, pos);
+        const unsigned int found    = mask(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(stop)));
+        const unsigned int newlines = mask(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+        if (found) {
+            return advance(found, newlines, pos, lines);
+        }
+        lines += bit_count(newlines);
+    }
+#endif
+    return scalar::until(text, size, pos, stop, lines);
+}
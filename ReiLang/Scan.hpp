@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+//
+// Run scanners for the hot loops of the Lexer.
+// Each one starts at pos and returns the position of the first byte that ends the run, or size.
+// The simd versions test 16 bytes at a time with SSE2 and finish the tail with the scalar ones,
+// where SSE2 is not available they are the scalar ones.
+//
+namespace scan {
+
+namespace scalar {
+
+// ' ', '\t', '\r' and '\n', newlines are added to lines
+size_t blanks(const char* text, size_t size, size_t pos, unsigned int& lines);
+// [A-Za-z0-9_]
+size_t identifier(const char* text, size_t size, size_t pos);
+// first stop byte, newlines before it are added to lines
+size_t until(const char* text, size_t size, size_t pos, char stop, unsigned int& lines);
+
+}
+
+namespace simd {
+
+size_t blanks(const char* text, size_t size, size_t pos, unsigned int& lines);
+size_t identifier(const char* text, size_t size, size_t pos);
+size_t until(const char* text, size_t size, size_t pos, char stop, unsigned int& lines);
+
+}
+
+}
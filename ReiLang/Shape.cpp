@@ -0,0 +1,35 @@
+#include "Shape.hpp"
+
+namespace {
+
+// 0 is left for empty cache entries
+std::uint64_t next_shape_id = 1;
+
+}
+
+Shape::Shape():
+    id_(next_shape_id++)
+{
+}
+
+Shape::Shape(const Shape& parent, const std::string_view field):
+    id_(next_shape_id++),
+    slots_(parent.slots_)
+{
+    slots_.emplace(field, static_cast<unsigned>(slots_.size()));
+}
+
+unsigned Shape::find(const std::string_view field) const
+{
+    const auto slot = slots_.find(field);
+    return slot != slots_.end() ? slot->second : npos;
+}
+
+Shape* Shape::transition(const std::string_view field)
+{
+    const auto next = transitions_.find(field);
+    if (next != transitions_.end()) {
+        return next->second.get();
+    }
+    return transitions_.emplace(field, std::unique_ptr<Shape>(new Shape(*this, field))).first->second.get();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "StringHash.hpp"
+
+class Callable;
+
+//
+// Hidden class of an instance: which field lives in which slot.
+// Instances of a class that get the same fields in the same order share a shape,
+// adding a field moves an instance along a transition to the child shape.
+// Every class owns the tree of shapes grown from its root, ids are never reused.
+//
+class Shape
+{
+public:
+    static constexpr unsigned int npos = ~0u;
+
+    Shape();
+
+    Shape(const Shape&)              = delete;
+    Shape& operator = (const Shape&) = delete;
+
+    [[nodiscard]] std::uint64_t id()         const { return id_;           }
+    [[nodiscard]] size_t        fieldCount() const { return slots_.size(); }
+    [[nodiscard]] unsigned int  find(std::string_view field) const;
+    [[nodiscard]] Shape*        transition(std::string_view field);
+private:
+    Shape(const Shape& parent, std::string_view field);
+
+    std::uint64_t                     id_;
+    StringMap<unsigned int>           slots_;
+    StringMap<std::unique_ptr<Shape>> transitions_;
+};
+
+//
+// Inline cache of a single property access site: remembers what the lookup resolved to
+// for the last few shapes seen there and stops learning once it is full (megamorphic).
+//
+class PropertyCache
+{
+public:
+    struct Entry
+    {
+        std::uint64_t shape  = 0;
+        unsigned int  slot   = Shape::npos;
+        Shape*        next   = nullptr;   // shape after adding the field, for stores
+        Callable*     method = nullptr;   // for loads that resolve to a method
+    };
+
+    static constexpr size_t capacity = 4;
+
+    [[nodiscard]] const Entry* find(const std::uint64_t shape) const
+    {
+        for (unsigned int i = 0; i < count_; i++) {
+            if (entries_[i].shape == shape) {
+                return &entries_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void add(const Entry& entry)
+    {
+        if (count_ < capacity) {
+            entries_[count_++] = entry;
+        }
+    }
+private:
+    std::array<Entry, capacity> entries_;
+    unsigned int                count_ = 0;
+};
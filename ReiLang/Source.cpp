@@ -0,0 +1,106 @@
+#include "Source.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Source::Source(const char* path):
+    view_(nullptr),
+    size_(0)
+{
+    if (map_(path)) {
+        text_ = { view_, size_ };
+        return;
+    }
+    std::ifstream fin{ path, std::ios::binary };
+    if (!fin) {
+        throw std::runtime_error("Bad file.");
+    }
+    read_(fin);
+}
+
+Source::Source(std::istream& stream):
+    view_(nullptr),
+    size_(0)
+{
+    read_(stream);
+}
+
+Source::~Source()
+{
+    if (!view_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(view_);
+#else
+    munmap(const_cast<char*>(view_), size_);
+#endif
+}
+
+// the file and mapping handles can go as soon as the view exists, it keeps them alive
+bool Source::map_(const char* path)
+{
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size{};
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return false;
+    }
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) {
+        return false;
+    }
+    view_ = static_cast<const char*>(view);
+    size_ = static_cast<size_t>(size.QuadPart);
+#else
+    const int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat info{};
+    if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        close(file);
+        return false;
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    madvise(view, size, MADV_SEQUENTIAL);
+    view_ = static_cast<const char*>(view);
+    size_ = size;
+#endif
+    return true;
+}
+
+void Source::read_(std::istream& stream)
+{
+    char chunk[64 * 1024];
+    while (stream.read(chunk, sizeof chunk) || stream.gcount() > 0) {
+        buffer_.append(chunk, static_cast<size_t>(stream.gcount()));
+    }
+    text_ = buffer_;
+}
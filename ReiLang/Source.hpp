@@ -0,0 +1,33 @@
+#pragma once
+#include <istream>
+#include <string>
+#include <string_view>
+
+//
+// Script text for the Lexer, which works on it in place.
+// Regular files are mapped read-only; pipes, stdin and files that can not be mapped are read into a buffer.
+// Tokens and the ast point into the text, so the source has to outlive the program.
+//
+class Source final
+{
+public:
+    explicit Source(const char* path);
+    explicit Source(std::istream& stream);
+
+    Source(const Source&)              = delete;
+    Source(Source&&)                   = delete;
+    Source& operator = (const Source&) = delete;
+    Source& operator = (Source&&)      = delete;
+    ~Source();
+
+    [[nodiscard]] std::string_view text()   const { return text_;            }
+    [[nodiscard]] bool             mapped() const { return view_ != nullptr; }
+private:
+    [[nodiscard]] bool map_(const char* path);
+    void read_(std::istream& stream);
+
+    const char*      view_;
+    size_t           size_;
+    std::string      buffer_;
+    std::string_view text_;
+};
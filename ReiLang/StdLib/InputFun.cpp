@@ -1,13 +1,16 @@
 #include "InputFun.hpp"
+#include "../Interpreter.hpp"
 #include <iostream>
 
-unsigned InputFun::arity() const
+InputFun::InputFun() :
+    Native(&InputFun::input)
 {
-    return 0;
 }
 
-Value InputFun::call(Interpreter& interpreter, std::vector<Value> args)
+Value InputFun::input(Interpreter& interpreter)
 {
+    // a prompt printed just before has to show up first
+    interpreter.output().flush();
     std::string input;
     std::cin >> input;
     return Value{ input };
@@ -1,11 +1,12 @@
 #pragma once
 
-#include "../Callable.hpp"
+#include "../Native.hpp"
 
-class InputFun : public Callable
+class InputFun : public Native
 {
 public:
-    [[nodiscard]] unsigned arity() const override;
-    Value call(Interpreter& interpreter, std::vector<Value> args) override;
+    InputFun();
     [[nodiscard]] std::string toString() const override;
+private:
+    static Value input(Interpreter& interpreter);
 };
@@ -1,13 +1,12 @@
 #include "NumFun.hpp"
 
-unsigned NumFun::arity() const
+NumFun::NumFun() :
+    Native(&NumFun::num)
 {
-    return 1;
 }
 
-Value NumFun::call(Interpreter& interpreter, std::vector<Value> args)
+Value NumFun::num(Interpreter& /*interpreter*/, const Value value)
 {
-    const Value value = args.front();
     switch (value.getType()) {
     case ValueType::Nil: return Value{};
     case ValueType::Bool: return value.isTrue() ? Value{ 1.0 } : Value{ 0.0 };
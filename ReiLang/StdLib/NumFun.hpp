@@ -1,10 +1,11 @@
 #pragma once
-#include "../Callable.hpp"
+#include "../Native.hpp"
 
-class NumFun : public Callable
+class NumFun : public Native
 {
 public:
-    [[nodiscard]] unsigned arity() const override;
-    Value call(Interpreter& interpreter, std::vector<Value> args) override;
+    NumFun();
     [[nodiscard]] std::string toString() const override;
+private:
+    static Value num(Interpreter& interpreter, Value value);
 };
@@ -1,22 +1,17 @@
 #include "RandFun.hpp"
-#include <random>
-#include <chrono>
+#include "../Interpreter.hpp"
 
-unsigned RandFun::arity() const
+RandFun::RandFun() :
+    Native(&RandFun::rand)
 {
-    return 2;
 }
 
-Value RandFun::call(Interpreter& interpreter, std::vector<Value> args)
+Value RandFun::rand(Interpreter& interpreter, const Value low, const Value high)
 {
-    const Value low = args[0], high = args[1];
     if (low.getType() != ValueType::Number || high.getType() != ValueType::Number) {
         return Value{};
     }
-    std::default_random_engine generator{ static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count()) };
-    std::uniform_int_distribution<int> distribution(std::floor(low.getNumber()), std::ceil(high.getNumber()));
-    const int rand = distribution(generator);
-    return Value{ static_cast<double>(rand) };
+    return Value{ interpreter.random().between(low.getNumber(), high.getNumber()) };
 }
 
 std::string RandFun::toString() const
@@ -1,10 +1,11 @@
 #pragma once
-#include "../Callable.hpp"
+#include "../Native.hpp"
 
-class RandFun : public Callable
+class RandFun : public Native
 {
 public:
-    [[nodiscard]] unsigned arity() const override;
-    Value call(Interpreter& interpreter, std::vector<Value> args) override;
+    RandFun();
     [[nodiscard]] std::string toString() const override;
+private:
+    static Value rand(Interpreter& interpreter, Value low, Value high);
 };
@@ -0,0 +1,20 @@
+#include "RandfFun.hpp"
+#include "../Interpreter.hpp"
+
+RandfFun::RandfFun() :
+    Native(&RandfFun::randf)
+{
+}
+
+Value RandfFun::randf(Interpreter& interpreter, const Value low, const Value high)
+{
+    if (low.getType() != ValueType::Number || high.getType() != ValueType::Number) {
+        return Value{};
+    }
+    return Value{ low.getNumber() + interpreter.random().uniform() * (high.getNumber() - low.getNumber()) };
+}
+
+std::string RandfFun::toString() const
+{
+    return "randf :: (num, num) -> num";
+}
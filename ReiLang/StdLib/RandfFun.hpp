@@ -0,0 +1,11 @@
+#pragma once
+#include "../Native.hpp"
+
+class RandfFun : public Native
+{
+public:
+    RandfFun();
+    [[nodiscard]] std::string toString() const override;
+private:
+    static Value randf(Interpreter& interpreter, Value low, Value high);
+};
@@ -0,0 +1,25 @@
+#include "SeedFun.hpp"
+#include "../Interpreter.hpp"
+#include <cstring>
+
+SeedFun::SeedFun() :
+    Native(&SeedFun::seed)
+{
+}
+
+Value SeedFun::seed(Interpreter& interpreter, const Value seed)
+{
+    // by bit pattern: every number, negative, huge or NaN, gives its own sequence
+    if (seed.getType() == ValueType::Number) {
+        const double number = seed.getNumber();
+        std::uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        interpreter.random().seed(bits);
+    }
+    return Value{};
+}
+
+std::string SeedFun::toString() const
+{
+    return "seed :: num -> nil";
+}
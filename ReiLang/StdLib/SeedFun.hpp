@@ -0,0 +1,11 @@
+#pragma once
+#include "../Native.hpp"
+
+class SeedFun : public Native
+{
+public:
+    SeedFun();
+    [[nodiscard]] std::string toString() const override;
+private:
+    static Value seed(Interpreter& interpreter, Value seed);
+};
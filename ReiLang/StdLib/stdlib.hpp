@@ -1,5 +1,7 @@
 #pragma once
 
 #include "RandFun.hpp"
+#include "RandfFun.hpp"
+#include "SeedFun.hpp"
 #include "NumFun.hpp"
 #include "InputFun.hpp"
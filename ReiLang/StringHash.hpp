@@ -0,0 +1,19 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <string_view>
+
+//
+// Transparent hash for maps keyed by std::string,
+// so that names coming from tokens are looked up without building a string.
+//
+struct StringHash
+{
+    using is_transparent = void;
+
+    size_t operator()(const std::string_view text) const { return std::hash<std::string_view>{}(text); }
+};
+
+template <typename T>
+using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
@@ -0,0 +1,85 @@
+#include "Timings.hpp"
+#include "Heap.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+std::size_t peak_rss()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters)) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    #ifdef __APPLE__
+        return static_cast<std::size_t>(usage.ru_maxrss);
+    #else
+        return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+    #endif
+#endif
+}
+
+void write_string(std::ostream& out, const std::string& str)
+{
+    out << '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+}
+
+Timings::Timings() :
+    start_(std::chrono::steady_clock::now()),
+    heap_(nullptr)
+{
+}
+
+void Timings::watch(Heap& heap)
+{
+    heap_ = &heap;
+    (void)heap_->takePeak();
+}
+
+const Timings::Phase& Timings::lap(std::string name)
+{
+    const auto end = std::chrono::steady_clock::now();
+    phases_.push_back({ std::move(name), end - start_, heap_ ? heap_->takePeak() : 0, peak_rss() });
+    // the probes above are not charged to the next phase
+    start_ = std::chrono::steady_clock::now();
+    return phases_.back();
+}
+
+void Timings::writeJson(std::ostream& out) const
+{
+    std::chrono::nanoseconds total{ 0 };
+    out << "{\n  \"phases\": [";
+    for (size_t i = 0; i < phases_.size(); i++) {
+        const auto& phase = phases_[i];
+        total += phase.duration;
+        out << (i > 0 ? ",\n" : "\n") << "    { \"name\": ";
+        write_string(out, phase.name);
+        out << ", \"ns\": " << phase.duration.count() << ", \"heapPeakBytes\": " << phase.heapPeak
+            << ", \"peakRssBytes\": " << phase.peakRss << " }";
+    }
+    out << "\n  ],\n  \"totalNs\": " << total.count() << "\n}\n";
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Heap;
+
+//
+// Durations of the pipeline phases at nanosecond resolution, each measured from the end of the previous one,
+// along with how much memory they took. Lexing runs on demand inside parsing and is counted there.
+//
+class Timings
+{
+public:
+    struct Phase
+    {
+        std::string              name;
+        std::chrono::nanoseconds duration;
+        // most bytes the watched heap held during the phase
+        std::size_t              heapPeak;
+        // high-water mark of the process at the end of the phase, 0 where unknown
+        std::size_t              peakRss;
+    };
+
+    Timings();
+    // heap whose peak is recorded from the next phase on, it has to outlive the phases that follow
+    void watch(Heap& heap);
+    // ends the current phase
+    const Phase& lap(std::string name);
+
+    [[nodiscard]] const std::vector<Phase>& phases() const { return phases_; }
+    void writeJson(std::ostream& out) const;
+private:
+    std::chrono::steady_clock::time_point start_;
+    Heap*                                 heap_;
+    std::vector<Phase>                    phases_;
+};
@@ -5,10 +5,10 @@ std::ostream& operator<<(std::ostream& stream, const Token& token)
 {
     stream << "(" << token.lexeme << " :: " << to_string(token.type);
     if (token.type == TokenType::Number) {
-        stream << " = " << std::get<double>(token.literal);
+        stream << " = " << token.number;
     }
     if (token.type == TokenType::String) {
-        stream << " = " << std::get<std::string>(token.literal);
+        stream << " = " << token.literal();
     }
     stream << ")";
     return stream;
@@ -110,10 +110,15 @@ const char* to_string(TokenType e)
     }
 }
 
-Token::Token(const TokenType t, std::string lex, std::variant<double, std::string> lit, unsigned int l) :
+Token::Token(const TokenType t, const std::string_view lex, const unsigned int l, const double num) :
     type(t),
-    lexeme(std::move(lex)),
-    literal(std::move(lit)),
-    line(l)
+    line(l),
+    lexeme(lex),
+    number(num)
 {
 }
+
+std::string_view Token::literal() const
+{
+    return lexeme.size() < 2 ? std::string_view{} : lexeme.substr(1, lexeme.size() - 2);
+}
@@ -1,6 +1,6 @@
 #pragma once
 #include <ostream>
-#include <variant>
+#include <string_view>
 
 enum class TokenType
 {
@@ -55,13 +55,20 @@ enum class TokenType
 
 const char* to_string(TokenType e);
 
+//
+// Tokens do not own their text: the lexeme is a view into the script,
+// which has to outlive the tokens and every ast node built from them.
+//
 struct Token
 {
-    Token(TokenType t, std::string lex, std::variant<double, std::string> lit, unsigned int l);
+    Token(TokenType t, std::string_view lex, unsigned int l, double num = 0.0);
 
-    TokenType type;
-    std::string lexeme;
-    std::variant<double, std::string> literal;
-    unsigned int line;
+    // contents of a String token without the quotes
+    [[nodiscard]] std::string_view literal() const;
+
+    TokenType        type;
+    unsigned int     line;
+    std::string_view lexeme;
+    double           number;
     friend std::ostream& operator << (std::ostream& stream, const Token& token);
 };
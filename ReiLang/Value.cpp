@@ -1,22 +1,10 @@
 #include "Value.hpp" // one more test
-#include <sstream>
-#include <iomanip>
+#include <charconv>
+#include <utility>
 
 #include "Callable.hpp"
 #include "Instance.hpp"
-
-const char* to_string(ValueType e)
-{
-    switch (e) {
-    case ValueType::Nil      : return "Nil";
-    case ValueType::Bool     : return "Bool";
-    case ValueType::Number   : return "Number";
-    case ValueType::String   : return "String";
-    case ValueType::Callable : return "Callable";
-    case ValueType::Instance : return "Instance";
-    default : return "unknown";
-    }
-}
+#include "Heap.hpp"
 
 ValueOperationException::ValueOperationException(std::string msg):
     msg_(std::move(msg))
@@ -33,47 +21,54 @@ char const* ValueOperationException::what() const
     return msg_.c_str();
 }
 
+static_assert(sizeof(Value) == sizeof(std::uint64_t), "Value must fit in a single machine word.");
+
 Value::Value():
-    type_(ValueType::Nil)
+    bits_(nil_)
 {
 }
 
 Value::Value(const bool value):
-    type_(ValueType::Bool),
-    value_(value)
+    bits_(value ? true_ : false_)
 {
 }
 
-Value::Value(const double value):
-    type_(ValueType::Number),
-    value_(value)
+Value::Value(const double value)
 {
+    if (value != value) {
+        // canonical NaN never collides with the tagged encodings
+        bits_ = 0x7ff8000000000000;
+    } else {
+        std::memcpy(&bits_, &value, sizeof(bits_));
+    }
 }
 
 Value::Value(std::string value):
-    type_(ValueType::String),
-    value_(std::move(value))
+    Value(static_cast<Object*>(Heap::current().allocate<StringObject>(std::move(value))))
+{
+}
+
+Value::Value(Callable* value):
+    Value(static_cast<Object*>(value))
 {
 }
 
-Value::Value(std::weak_ptr<Callable> value):
-    type_(ValueType::Callable),
-    value_(std::move(value))
+Value::Value(Instance* value):
+    Value(static_cast<Object*>(value))
 {
 }
 
-Value::Value(std::weak_ptr<Instance> value):
-    type_(ValueType::Instance),
-    value_(std::move(value))
+Value::Value(Object* object):
+    bits_(sign_ | qnan_ | static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(object)))
 {
 }
 
 Value Value::operator-() const
 {
-    if (type_ == ValueType::Number) {
-        return Value{ -1 * std::get<double>(value_) };
+    if (isNumber()) {
+        return Value{ -getNumber() };
     }
-    throw ValueOperationException{ type_, ValueType::Number };
+    throw ValueOperationException{ getType(), ValueType::Number };
 }
 
 Value Value::operator!() const
@@ -83,68 +78,62 @@ Value Value::operator!() const
 
 Value Value::operator+(const Value& rhs) const
 {
-    if (type_ == ValueType::Number && rhs.type_ == ValueType::Number) {
-        return Value{ std::get<double>(value_) + std::get<double>(rhs.value_) };
+    if (isNumber() && rhs.isNumber()) {
+        return Value{ getNumber() + rhs.getNumber() };
     }
-    if (type_ == ValueType::String || rhs.type_ == ValueType::String) {
+    if (getType() == ValueType::String || rhs.getType() == ValueType::String) {
         return Value{ toString() + rhs.toString() };
     }
-    throw ValueOperationException{ rhs.type_, type_ };
+    throw ValueOperationException{ rhs.getType(), getType() };
 }
 
 Value Value::operator-(const Value& rhs) const
 {
-    if (type_ == ValueType::Number && rhs.type_ == ValueType::Number) {
-        return Value{ std::get<double>(value_) - std::get<double>(rhs.value_) };
+    if (isNumber() && rhs.isNumber()) {
+        return Value{ getNumber() - rhs.getNumber() };
     }
-    if (type_ == ValueType::Number) {
-        throw ValueOperationException{ rhs.type_, ValueType::Number };
+    if (isNumber()) {
+        throw ValueOperationException{ rhs.getType(), ValueType::Number };
     }
-    throw ValueOperationException{ type_, ValueType::Number };
+    throw ValueOperationException{ getType(), ValueType::Number };
 }
 
 Value Value::operator*(const Value& rhs) const
 {
-    if (type_ == ValueType::Number && rhs.type_ == ValueType::Number) {
-        return Value{ std::get<double>(value_) * std::get<double>(rhs.value_) };
+    if (isNumber() && rhs.isNumber()) {
+        return Value{ getNumber() * rhs.getNumber() };
     }
-    if (type_ == ValueType::Number) {
-        throw ValueOperationException{ rhs.type_, ValueType::Number };
+    if (isNumber()) {
+        throw ValueOperationException{ rhs.getType(), ValueType::Number };
     }
-    throw ValueOperationException{ type_, ValueType::Number };
+    throw ValueOperationException{ getType(), ValueType::Number };
 }
 
 Value Value::operator/(const Value& rhs) const
 {
-    if (type_ == ValueType::Number && rhs.type_ == ValueType::Number) {
+    if (isNumber() && rhs.isNumber()) {
         if (rhs.getNumber() == 0) {
             throw ValueOperationException{ "Zero division." };
         }
-        return Value{ std::get<double>(value_) / std::get<double>(rhs.value_) };
+        return Value{ getNumber() / rhs.getNumber() };
     }
-    if (type_ == ValueType::Number) {
-        throw ValueOperationException{ rhs.type_, ValueType::Number };
+    if (isNumber()) {
+        throw ValueOperationException{ rhs.getType(), ValueType::Number };
     }
-    throw ValueOperationException{ type_, ValueType::Number };
+    throw ValueOperationException{ getType(), ValueType::Number };
 }
 
 Value Value::operator==(const Value& rhs) const
 {
-    if (type_ != rhs.type_) {
-        return Value{ false };
+    if (isNumber() && rhs.isNumber()) {
+        return Value{ getNumber() == rhs.getNumber() };
     }
-    switch (type_) {
-    case ValueType::Nil: 
+    if (bits_ == rhs.bits_) {
         return Value{ true };
-    case ValueType::Bool:
-        return Value{ std::get<bool>(value_) == std::get<bool>(rhs.value_) };
-    case ValueType::Number:
-        return Value{ std::get<double>(value_) == std::get<double>(rhs.value_) };
-    case ValueType::String:
-        return Value{ std::get<std::string>(value_) == std::get<std::string>(rhs.value_) };
-    default: ;
     }
-    // unreachable
+    if (getType() == ValueType::String && rhs.getType() == ValueType::String) {
+        return Value{ getString() == rhs.getString() };
+    }
     return Value{ false };
 }
 
@@ -155,13 +144,13 @@ Value Value::operator!=(const Value& rhs) const
 
 Value Value::operator<(const Value& rhs) const
 {
-    if (type_ == ValueType::Number && rhs.type_ == ValueType::Number) {
-        return Value{ std::get<double>(value_) < std::get<double>(rhs.value_) };
+    if (isNumber() && rhs.isNumber()) {
+        return Value{ getNumber() < rhs.getNumber() };
     }
-    if (type_ == ValueType::Number) {
-        throw ValueOperationException{ rhs.type_, ValueType::Number };
+    if (isNumber()) {
+        throw ValueOperationException{ rhs.getType(), ValueType::Number };
     }
-    throw ValueOperationException{ type_, ValueType::Number };
+    throw ValueOperationException{ getType(), ValueType::Number };
 }
 
 Value Value::operator<=(const Value& rhs) const
@@ -169,13 +158,20 @@ Value Value::operator<=(const Value& rhs) const
     return *this < rhs || *this == rhs;
 }
 
+// compared directly rather than negated, so that NaN is neither greater nor smaller than anything
 Value Value::operator>(const Value& rhs) const
 {
+    if (isNumber() && rhs.isNumber()) {
+        return Value{ getNumber() > rhs.getNumber() };
+    }
     return !(*this <= rhs);
 }
 
 Value Value::operator>=(const Value& rhs) const
 {
+    if (isNumber() && rhs.isNumber()) {
+        return Value{ getNumber() >= rhs.getNumber() };
+    }
     return !(*this < rhs);
 }
 
@@ -191,69 +187,75 @@ Value Value::operator&&(const Value& rhs) const
 
 ValueType Value::getType() const
 {
-    return type_;
-}
-
-bool Value::isTrue() const
-{
-    return type_ == ValueType::Bool ? getBool() : type_ != ValueType::Nil;
-}
-
-bool Value::getBool() const
-{
-    return std::get<bool>(value_);
-}
-
-double Value::getNumber() const
-{
-    return std::get<double>(value_);
+    if (isNumber()) {
+        return ValueType::Number;
+    }
+    if (isObject()) {
+        switch (getObject()->objectType()) {
+        case ObjectType::String   : return ValueType::String;
+        case ObjectType::Instance : return ValueType::Instance;
+        default                   : return ValueType::Callable;
+        }
+    }
+    return bits_ == nil_ ? ValueType::Nil : ValueType::Bool;
 }
 
-std::shared_ptr<Callable> Value::getCallable() const
+Callable* Value::getCallable() const
 {
-    return std::get<std::weak_ptr<Callable>>(value_).lock();
+    return static_cast<Callable*>(getObject());
 }
 
-std::shared_ptr<Instance> Value::getInstance() const
+Instance* Value::getInstance() const
 {
-    return std::get<std::weak_ptr<Instance>>(value_).lock();
+    return static_cast<Instance*>(getObject());
 }
 
-std::string Value::getString() const
+const std::string& Value::getString() const
 {
-    return std::get<std::string>(value_);
+    return static_cast<StringObject*>(getObject())->str();
 }
 
 std::string Value::toString() const
 {
-    switch (type_) {
+    switch (getType()) {
     case ValueType::Nil: 
         return "nil";
     case ValueType::Bool: 
         return isTrue() ? "true" : "false";
     case ValueType::Number: {
-        std::ostringstream strout;
-        strout << std::fixed << std::setprecision(15) << std::get<double>(value_);
-        std::string str = strout.str();
-        size_t end = str.find_last_not_of('0') + 1;
-        if (str[end - 1] == '.') end -= 1;
-        return str.erase(end);
+        char str[number_chars];
+        return { str, formatNumber(getNumber(), str) };
     }
     case ValueType::String:
-        return std::get<std::string>(value_);
+        return getString();
     case ValueType::Callable:
-        return std::get<std::shared_ptr<Callable>>(value_)->toString();
+        return getCallable()->toString();
     case ValueType::Instance:
-        return std::get<std::shared_ptr<Instance>>(value_)->toString();
+        return getInstance()->toString();
     default: ;
     }
     // unreachable
     return "";
 }
 
+std::size_t Value::formatNumber(const double number, char* out)
+{
+    const auto end = std::to_chars(out, out + number_chars, number, std::chars_format::fixed, 15).ptr;
+    std::size_t size = end - out;
+    if (std::memchr(out, '.', size)) {
+        while (out[size - 1] == '0') {
+            --size;
+        }
+        if (out[size - 1] == '.') {
+            --size;
+        }
+    }
+    return size;
+}
+
 std::string Value::toPrinter() const
 {
-    if (type_ == ValueType::String) {
+    if (getType() == ValueType::String) {
         return "\"" + toString() + "\"";
     }
     return toString();
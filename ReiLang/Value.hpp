@@ -1,24 +1,14 @@
 #pragma once
 
-#include <variant>
 #include <string>
-#include <memory>
+#include <cstdint>
+#include <cstring>
+
+#include "Object.hpp"
 
 class Callable;
 class Instance;
 
-enum class ValueType
-{
-    Nil,
-    Bool,
-    Number,
-    String,
-    Callable,
-    Instance
-};
-
-const char* to_string(ValueType e);
-
 class ValueOperationException final : std::exception
 {
 public:
@@ -29,6 +19,13 @@ private:
     std::string msg_;
 };
 
+//
+// NaN-boxed value: a single 64-bit word.
+// Any double that is not a quiet NaN with the tag bits set is stored as is,
+// nil and booleans are encoded in the low bits of the quiet NaN,
+// heap objects (strings, callables, instances) - as a pointer under the sign bit.
+// Values do not own objects, the Heap keeps them alive while they are reachable.
+//
 class Value
 {
 public:
@@ -36,8 +33,9 @@ public:
     explicit Value(bool value);
     explicit Value(double value);
     explicit Value(std::string value);
-    explicit Value(std::weak_ptr<Callable> value);
-    explicit Value(std::weak_ptr<Instance> value);
+    explicit Value(Callable* value);
+    explicit Value(Instance* value);
+    explicit Value(Object* object);
 
     Value operator -  ()                 const;
     Value operator !  ()                 const;
@@ -54,23 +52,42 @@ public:
     Value operator || (const Value& rhs) const;
     Value operator && (const Value& rhs) const;
 
-    [[nodiscard]] ValueType                 getType()     const;
-    [[nodiscard]] bool                      isTrue()      const;
-    [[nodiscard]] bool                      getBool()     const;
-    [[nodiscard]] double                    getNumber()   const;
-    [[nodiscard]] std::shared_ptr<Callable> getCallable() const;
-    [[nodiscard]] std::shared_ptr<Instance> getInstance() const;
-    [[nodiscard]] std::string               getString()   const;
-    [[nodiscard]] std::string               toString()    const;
-    [[nodiscard]] std::string               toPrinter()   const;
+    [[nodiscard]] ValueType          getType()     const;
+    [[nodiscard]] bool               isNumber()    const { return (bits_ & qnan_) != qnan_; }
+    [[nodiscard]] bool               isObject()    const { return (bits_ & (sign_ | qnan_)) == (sign_ | qnan_); }
+    [[nodiscard]] bool               isTrue()      const;
+    [[nodiscard]] bool               getBool()     const { return bits_ == true_; }
+    [[nodiscard]] double             getNumber()   const;
+    [[nodiscard]] Callable*          getCallable() const;
+    [[nodiscard]] Instance*          getInstance() const;
+    [[nodiscard]] const std::string& getString()   const;
+    [[nodiscard]] Object*            getObject()   const { return reinterpret_cast<Object*>(static_cast<std::uintptr_t>(bits_ & ~(sign_ | qnan_))); }
+    [[nodiscard]] std::string        toString()    const;
+    [[nodiscard]] std::string        toPrinter()   const;
+
+    // a number in fixed notation: up to 309 integer digits, sign, point and 15 decimals
+    static constexpr std::size_t number_chars = 330;
+    // writes a number the way toString does, without its trailing zeros; returns the length
+    static std::size_t formatNumber(double number, char* out);
 
 private:
-    ValueType type_;
-    std::variant<
-        bool, 
-        double, 
-        std::string, 
-        std::weak_ptr<Callable>, 
-        std::weak_ptr<Instance>
-    > value_;
+    static constexpr std::uint64_t sign_  = 0x8000000000000000;
+    static constexpr std::uint64_t qnan_  = 0x7ffc000000000000;
+    static constexpr std::uint64_t nil_   = qnan_ | 1;
+    static constexpr std::uint64_t false_ = qnan_ | 2;
+    static constexpr std::uint64_t true_  = qnan_ | 3;
+
+    std::uint64_t bits_;
 };
+
+inline bool Value::isTrue() const
+{
+    return bits_ != nil_ && bits_ != false_;
+}
+
+inline double Value::getNumber() const
+{
+    double number;
+    std::memcpy(&number, &bits_, sizeof(number));
+    return number;
+}
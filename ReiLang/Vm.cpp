@@ -0,0 +1,428 @@
+#include "Vm.hpp"
+#include <sstream>
+
+#include "Instance.hpp"
+#include "Interpreter.hpp"
+#include "Native.hpp"
+
+Vm::Vm(Interpreter& host, Heap& heap, const std::vector<std::string>& globals):
+    host_(host),
+    heap_(heap),
+    stack_(new Value[stack_max_]),
+    top_(stack_.get()),
+    open_upvalues_(nullptr),
+    globals_(globals.size()),
+    defined_(globals.size(), false),
+    global_names_(globals)
+{
+    frames_.reserve(frames_max_);
+    // natives are defined by the host before any script code runs
+    for (size_t i = 0; i < globals.size(); i++) {
+        if (host_.global_->contains(globals[i])) {
+            globals_[i] = host_.global_->lookup(globals[i]);
+            defined_[i] = true;
+        }
+    }
+}
+
+void Vm::run(Prototype* script)
+{
+    auto* closure = heap_.allocate<Closure>(script);
+    push_(Value{ static_cast<Callable*>(closure) });
+    call_(closure, 0, 0);
+    execute_(0);
+    top_ = stack_.get();
+}
+
+Value Vm::invoke(const Value& callee, const Args args)
+{
+    const size_t base = frames_.size();
+    push_(callee);
+    for (auto& a : args) {
+        push_(a);
+    }
+    call_value_(callee, static_cast<unsigned>(args.size()), 0);
+    if (frames_.size() > base) {
+        execute_(base);
+    }
+    return pop_();
+}
+
+void Vm::execute_(const size_t base)
+{
+    Frame* frame = &frames_.back();
+    const std::uint8_t* ip = frame->ip;
+    const Value* constants = frame->closure->prototype()->chunk().constants().data();
+    PropertyCache* caches = frame->closure->prototype()->chunk().caches();
+
+    const auto read_byte  = [&ip]() { return *ip++; };
+    const auto read_short = [&ip]() { ip += 2; return static_cast<std::uint16_t>(ip[-2] << 8 | ip[-1]); };
+    const auto line = [&frame, &ip]() {
+        const auto& chunk = frame->closure->prototype()->chunk();
+        return chunk.line(ip - chunk.code().data() - 1);
+    };
+    const auto reload = [&]() {
+        frame = &frames_.back();
+        ip = frame->ip;
+        constants = frame->closure->prototype()->chunk().constants().data();
+        caches = frame->closure->prototype()->chunk().caches();
+    };
+
+    try {
+        while (true) {
+            switch (static_cast<OpCode>(read_byte())) {
+            case OpCode::Constant:
+                push_(constants[read_short()]);
+                break;
+            case OpCode::Nil:
+                push_(Value{});
+                break;
+            case OpCode::True:
+                push_(Value{ true });
+                break;
+            case OpCode::False:
+                push_(Value{ false });
+                break;
+            case OpCode::Pop:
+                top_--;
+                break;
+            case OpCode::GetLocal:
+                push_(frame->slots[read_byte()]);
+                break;
+            case OpCode::SetLocal:
+                frame->slots[read_byte()] = peek_(0);
+                break;
+            case OpCode::GetGlobal: {
+                const auto index = read_short();
+                if (!defined_[index]) {
+                    error_(line(), EnvironmentException{ global_names_[index] }.what());
+                }
+                push_(globals_[index]);
+                break;
+            }
+            case OpCode::DefineGlobal: {
+                const auto index = read_short();
+                globals_[index] = pop_();
+                defined_[index] = true;
+                break;
+            }
+            case OpCode::SetGlobal: {
+                const auto index = read_short();
+                if (!defined_[index]) {
+                    error_(line(), EnvironmentException{ global_names_[index] }.what());
+                }
+                globals_[index] = peek_(0);
+                break;
+            }
+            case OpCode::GetUpvalue:
+                push_(*frame->closure->upvalues()[read_byte()]->location);
+                break;
+            case OpCode::SetUpvalue:
+                *frame->closure->upvalues()[read_byte()]->location = peek_(0);
+                break;
+            case OpCode::GetProperty: {
+                const Value& name = constants[read_short()];
+                auto& cache = caches[read_short()];
+                if (peek_(0).getType() != ValueType::Instance) {
+                    error_(line(), "Only instances have properties.");
+                }
+                peek_(0) = peek_(0).getInstance()->get(heap_, name.getString(), cache);
+                break;
+            }
+            case OpCode::SetProperty: {
+                const Value& name = constants[read_short()];
+                auto& cache = caches[read_short()];
+                if (peek_(1).getType() != ValueType::Instance) {
+                    error_(line(), "Only instances have fields.");
+                }
+                const Value value = pop_();
+                pop_().getInstance()->put(name.getString(), value, cache);
+                push_(value);
+                break;
+            }
+            case OpCode::Equal: {
+                const Value r = pop_();
+                peek_(0) = peek_(0) == r;
+                break;
+            }
+            case OpCode::NotEqual: {
+                const Value r = pop_();
+                peek_(0) = peek_(0) != r;
+                break;
+            }
+            case OpCode::Greater: {
+                const Value r = pop_();
+                Value& l = peek_(0);
+                l = l.isNumber() && r.isNumber() ? Value{ l.getNumber() > r.getNumber() } : l > r;
+                break;
+            }
+            case OpCode::GreaterEqual: {
+                const Value r = pop_();
+                Value& l = peek_(0);
+                l = l.isNumber() && r.isNumber() ? Value{ l.getNumber() >= r.getNumber() } : l >= r;
+                break;
+            }
+            case OpCode::Less: {
+                const Value r = pop_();
+                Value& l = peek_(0);
+                l = l.isNumber() && r.isNumber() ? Value{ l.getNumber() < r.getNumber() } : l < r;
+                break;
+            }
+            case OpCode::LessEqual: {
+                const Value r = pop_();
+                Value& l = peek_(0);
+                l = l.isNumber() && r.isNumber() ? Value{ l.getNumber() <= r.getNumber() } : l <= r;
+                break;
+            }
+            case OpCode::Add: {
+                const Value r = pop_();
+                Value& l = peek_(0);
+                l = l.isNumber() && r.isNumber() ? Value{ l.getNumber() + r.getNumber() } : l + r;
+                break;
+            }
+            case OpCode::Subtract: {
+                const Value r = pop_();
+                Value& l = peek_(0);
+                l = l.isNumber() && r.isNumber() ? Value{ l.getNumber() - r.getNumber() } : l - r;
+                break;
+            }
+            case OpCode::Multiply: {
+                const Value r = pop_();
+                Value& l = peek_(0);
+                l = l.isNumber() && r.isNumber() ? Value{ l.getNumber() * r.getNumber() } : l * r;
+                break;
+            }
+            case OpCode::Divide: {
+                const Value r = pop_();
+                peek_(0) = peek_(0) / r;
+                break;
+            }
+            case OpCode::Not:
+                peek_(0) = Value{ !peek_(0).isTrue() };
+                break;
+            case OpCode::Negate:
+                peek_(0) = -peek_(0);
+                break;
+            case OpCode::Print:
+                host_.output().print(pop_());
+                break;
+            case OpCode::Jump: {
+                const auto offset = read_short();
+                ip += offset;
+                break;
+            }
+            case OpCode::JumpIfFalse: {
+                const auto offset = read_short();
+                if (!peek_(0).isTrue()) {
+                    ip += offset;
+                }
+                break;
+            }
+            case OpCode::Loop: {
+                const auto offset = read_short();
+                if (host_.profiler_ && host_.profiler_->due()) {
+                    frame->ip = ip;
+                    sample_();
+                }
+                ip -= offset;
+                if (heap_.needsCollection()) {
+                    collect_garbage_();
+                }
+                break;
+            }
+            case OpCode::Call: {
+                const auto argc = read_byte();
+                frame->ip = ip;
+                if (host_.profiler_ && host_.profiler_->due()) {
+                    sample_();
+                }
+                if (heap_.needsCollection()) {
+                    collect_garbage_();
+                }
+                call_value_(peek_(argc), argc, line());
+                reload();
+                break;
+            }
+            case OpCode::Invoke: {
+                const Value& name = constants[read_short()];
+                auto& cache = caches[read_short()];
+                const auto argc = read_byte();
+                frame->ip = ip;
+                if (host_.profiler_ && host_.profiler_->due()) {
+                    sample_();
+                }
+                if (heap_.needsCollection()) {
+                    collect_garbage_();
+                }
+                Value& receiver = peek_(argc);
+                if (receiver.getType() != ValueType::Instance) {
+                    error_(line(), "Only instances have properties.");
+                }
+                const auto property = receiver.getInstance()->lookup(name.getString(), cache);
+                if (property.method && property.method->objectType() == ObjectType::Closure) {
+                    call_(static_cast<Closure*>(property.method), argc, line());
+                } else {
+                    receiver = property.method ? Value{ property.method->bind(heap_, receiver.getInstance()) } : property.value;
+                    call_value_(receiver, argc, line());
+                }
+                reload();
+                break;
+            }
+            case OpCode::Closure: {
+                auto* prototype = static_cast<Prototype*>(constants[read_short()].getObject());
+                auto* closure = heap_.allocate<Closure>(prototype);
+                push_(Value{ static_cast<Callable*>(closure) });
+                for (auto& upvalue : closure->upvalues()) {
+                    const bool is_local = read_byte() == 1;
+                    const auto index = read_byte();
+                    upvalue = is_local ? capture_(frame->slots + index) : frame->closure->upvalues()[index];
+                }
+                break;
+            }
+            case OpCode::CloseUpvalue:
+                close_upvalues_(top_ - 1);
+                top_--;
+                break;
+            case OpCode::Return: {
+                // a function that neither calls nor loops is only ever on top of the stack here
+                if (host_.profiler_ && host_.profiler_->due()) {
+                    frame->ip = ip;
+                    sample_();
+                }
+                const Value result = pop_();
+                close_upvalues_(frame->slots);
+                top_ = frame->slots;
+                frames_.pop_back();
+                push_(result);
+                if (frames_.size() == base) {
+                    return;
+                }
+                reload();
+                break;
+            }
+            case OpCode::Class: {
+                const Value& name = constants[read_short()];
+                push_(Value{ static_cast<Callable*>(heap_.allocate<Klass>(name.getString(), Klass::Methods{})) });
+                break;
+            }
+            case OpCode::Method: {
+                const Value& name = constants[read_short()];
+                auto* klass = static_cast<Klass*>(peek_(1).getObject());
+                klass->addMethod(name.getString(), peek_(0).getCallable());
+                top_--;
+                break;
+            }
+            default:
+                error_(line(), "Unknown instruction.");
+            }
+        }
+    } catch (const ValueOperationException& voe) {
+        error_(line(), voe.what());
+    } catch (const InstanceException& ie) {
+        error_(line(), ie.what());
+    }
+}
+
+void Vm::call_value_(const Value callee, const unsigned argc, const unsigned line)
+{
+    if (callee.getType() != ValueType::Callable) {
+        error_(line, "Can only call functions and classes.");
+    }
+    auto* fun = callee.getCallable();
+    switch (fun->objectType()) {
+    case ObjectType::Closure:
+        call_(static_cast<Closure*>(fun), argc, line);
+        return;
+    case ObjectType::BoundMethod: {
+        auto* bound = static_cast<BoundMethod*>(fun);
+        peek_(argc) = Value{ bound->receiver() };
+        call_(bound->method(), argc, line);
+        return;
+    }
+    default:
+        break;
+    }
+    if (argc != fun->arity()) {
+        std::ostringstream strout;
+        strout << "Expected " << fun->arity() << " arguments but got " << argc << ".";
+        error_(line, strout.str());
+    }
+    // the arguments stay on the stack for the callee to read in place
+    const Value result = fun->objectType() == ObjectType::Native ? static_cast<Native*>(fun)->enter(host_, top_ - argc)
+                                                                  : fun->call(host_, { top_ - argc, argc });
+    top_ -= argc + 1;
+    push_(result);
+}
+
+void Vm::call_(Closure* closure, const unsigned argc, const unsigned line)
+{
+    if (argc != closure->arity()) {
+        std::ostringstream strout;
+        strout << "Expected " << closure->arity() << " arguments but got " << argc << ".";
+        error_(line, strout.str());
+    }
+    if (frames_.size() == frames_max_ || top_ - stack_.get() + 256 > static_cast<std::ptrdiff_t>(stack_max_)) {
+        error_(line, "Stack overflow.");
+    }
+    frames_.push_back({ closure, closure->prototype()->chunk().code().data(), top_ - argc - 1 });
+}
+
+Upvalue* Vm::capture_(Value* local)
+{
+    Upvalue** link = &open_upvalues_;
+    while (*link && (*link)->location > local) {
+        link = &(*link)->next;
+    }
+    if (*link && (*link)->location == local) {
+        return *link;
+    }
+    auto* upvalue = heap_.allocate<Upvalue>(local);
+    upvalue->next = *link;
+    *link = upvalue;
+    return upvalue;
+}
+
+void Vm::close_upvalues_(const Value* last)
+{
+    while (open_upvalues_ && open_upvalues_->location >= last) {
+        open_upvalues_->close();
+        open_upvalues_ = open_upvalues_->next;
+    }
+}
+
+void Vm::collect_garbage_()
+{
+    heap_.collect([this](Heap& heap) {
+        for (const Value* slot = stack_.get(); slot < top_; slot++) {
+            heap.mark(*slot);
+        }
+        for (auto& frame : frames_) {
+            heap.mark(frame.closure);
+        }
+        for (auto* upvalue = open_upvalues_; upvalue; upvalue = upvalue->next) {
+            heap.mark(upvalue);
+        }
+        for (auto& value : globals_) {
+            heap.mark(value);
+        }
+        heap.mark(host_.global_);
+    });
+}
+
+void Vm::sample_()
+{
+    Profiler& profiler = *host_.profiler_;
+    std::vector<Profiler::Frame> stack;
+    stack.reserve(frames_.size());
+    for (const auto& frame : frames_) {
+        Prototype* prototype = frame.closure->prototype();
+        const auto& chunk = prototype->chunk();
+        stack.push_back({ profiler.intern(prototype->name()), chunk.line(frame.ip - chunk.code().data() - 1) });
+    }
+    profiler.sample(stack.data(), stack.size());
+}
+
+void Vm::error_(const unsigned line, const std::string& msg) const
+{
+    throw Interpreter::RuntimeError{ line, msg };
+}
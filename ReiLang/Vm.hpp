@@ -0,0 +1,64 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Closure.hpp"
+#include "Heap.hpp"
+
+class Interpreter;
+
+//
+// Stack machine running the Compiler output.
+// Every call gets a window of the value stack starting at its callee (or receiver) slot,
+// natives and classes from the host interpreter are called through the Callable interface.
+//
+class Vm
+{
+public:
+    Vm(Interpreter& host, Heap& heap, const std::vector<std::string>& globals);
+
+    Vm(const Vm&)              = delete;
+    Vm(Vm&&)                   = delete;
+    Vm& operator = (const Vm&) = delete;
+    Vm& operator = (Vm&&)      = delete;
+    ~Vm()                      = default;
+
+    void run(Prototype* script);
+    // calls a closure or bound method from native code and runs it to completion
+    Value invoke(const Value& callee, Args args);
+private:
+    static constexpr size_t frames_max_ = 1024;
+    static constexpr size_t stack_max_  = frames_max_ * 256;
+
+    struct Frame
+    {
+        Closure*            closure;
+        const std::uint8_t* ip;
+        Value*              slots;
+    };
+
+    void execute_(size_t base);
+    void call_value_(Value callee, unsigned int argc, unsigned int line);
+    void call_(Closure* closure, unsigned int argc, unsigned int line);
+    [[nodiscard]] Upvalue* capture_(Value* local);
+    void close_upvalues_(const Value* last);
+    void collect_garbage_();
+    // hands the call stack to the host's profiler, the ip of every frame must be saved
+    void sample_();
+    [[noreturn]] void error_(unsigned int line, const std::string& msg) const;
+
+    void push_(const Value& value) { *top_++ = value; }
+    Value pop_()                   { return *--top_; }
+    [[nodiscard]] Value& peek_(const size_t distance) const { return top_[-1 - static_cast<std::ptrdiff_t>(distance)]; }
+
+    Interpreter&                  host_;
+    Heap&                         heap_;
+    std::unique_ptr<Value[]>      stack_;
+    Value*                        top_;
+    std::vector<Frame>            frames_;
+    Upvalue*                      open_upvalues_;
+    std::vector<Value>            globals_;
+    std::vector<bool>             defined_;
+    const std::vector<std::string>& global_names_;
+};